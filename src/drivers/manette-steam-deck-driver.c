@@ -34,6 +34,11 @@
 
 #define STICK_FLAT 2500
 
+/* The controller goes back to lizard mode after a while without being told
+ * not to.
+ */
+#define LIZARD_WATCHDOG_INTERVAL 800
+
 typedef enum {
   ID_SET_DIGITAL_MAPPINGS              = 0x80,
   ID_CLEAR_DIGITAL_MAPPINGS            = 0x81,
@@ -367,7 +372,14 @@ struct _ManetteSteamDeckDriver {
 
   hid_device *hid;
 
-  guint rumble_timeout;
+  /* Feature reports block for several milliseconds, so after initialization
+   * they are only sent from this thread, which also runs the lizard mode
+   * watchdog and the rumble timeout. Only it may touch rumble_source.
+   */
+  GThread *control_thread;
+  GMainContext *control_context;
+  GMainLoop *control_loop;
+  GSource *rumble_source;
 
   guint32 last_packet;
   guint32 last_buttons_l;
@@ -379,7 +391,7 @@ struct _ManetteSteamDeckDriver {
   short last_trigger_l;
   short last_trigger_r;
 
-  int lizard_watchdog_counter;
+  ManetteHidDriverEventSink event_sink;
 };
 
 static void manette_steam_deck_hid_driver_init (ManetteHidDriverInterface *iface);
@@ -549,8 +561,8 @@ send_absolute_event (ManetteSteamDeckDriver *self,
   else
     axis_value = (double) value / 32767.0;
 
-  manette_hid_driver_emit_axis_event (MANETTE_HID_DRIVER (self),
-                                      time, axis, axis_value);
+  manette_hid_driver_event_sink_emit_axis (&self->event_sink,
+                                           time, axis, axis_value);
 }
 
 static void
@@ -566,8 +578,8 @@ handle_button_l (ManetteSteamDeckDriver *self,
   if (old_pressed == new_pressed)
     return;
 
-  manette_hid_driver_emit_button_event (MANETTE_HID_DRIVER (self),
-                                        time, button, new_pressed);
+  manette_hid_driver_event_sink_emit_button (&self->event_sink,
+                                             time, button, new_pressed);
 }
 
 static void
@@ -583,8 +595,8 @@ handle_button_h (ManetteSteamDeckDriver *self,
   if (old_pressed == new_pressed)
     return;
 
-  manette_hid_driver_emit_button_event (MANETTE_HID_DRIVER (self),
-                                        time, button, new_pressed);
+  manette_hid_driver_event_sink_emit_button (&self->event_sink,
+                                             time, button, new_pressed);
 }
 
 static inline short
@@ -664,12 +676,105 @@ handle_state (ManetteSteamDeckDriver *self,
   self->last_trigger_r = state->trigger_raw_r;
 }
 
+static gboolean
+send_rumble (ManetteSteamDeckDriver *self,
+             guint16                 left_speed,
+             guint16                 right_speed)
+{
+  guint8 buffer[sizeof (RumbleReport) + 1] = { 0 };
+  RumbleReport *report = (RumbleReport *) (buffer + 1);
+
+  report->header.type = ID_TRIGGER_RUMBLE_CMD;
+  report->rumble_type = 0;
+  report->intensity = HAPTIC_INTENSITY_SYSTEM;
+  report->left_motor_speed = left_speed;
+  report->right_motor_speed = right_speed;
+  report->left_gain = 2;
+  report->right_gain = 0;
+
+  G_LOCK (hidapi);
+
+  int r = hid_send_feature_report (self->hid, buffer, sizeof (buffer));
+  if (r < 0) {
+    g_warning ("Failed to rumble: %ls", hid_error (self->hid));
+    G_UNLOCK (hidapi);
+
+    return FALSE;
+  }
+
+  G_UNLOCK (hidapi);
+
+  return TRUE;
+}
+
+static gboolean
+watchdog_cb (ManetteSteamDeckDriver *self)
+{
+  disable_lizard_mode (self);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static gpointer
+control_thread_func (ManetteSteamDeckDriver *self)
+{
+  g_autoptr (GSource) watchdog_source = NULL;
+
+  g_main_context_push_thread_default (self->control_context);
+
+  watchdog_source = g_timeout_source_new (LIZARD_WATCHDOG_INTERVAL);
+  g_source_set_callback (watchdog_source, G_SOURCE_FUNC (watchdog_cb), self, NULL);
+  g_source_attach (watchdog_source, self->control_context);
+
+  g_main_loop_run (self->control_loop);
+
+  g_source_destroy (watchdog_source);
+
+  /* Don't leave the device rumbling once nothing can stop it anymore */
+  if (self->rumble_source) {
+    g_source_destroy (self->rumble_source);
+    g_clear_pointer (&self->rumble_source, g_source_unref);
+
+    send_rumble (self, 0, 0);
+  }
+
+  g_main_context_pop_thread_default (self->control_context);
+
+  return NULL;
+}
+
+static gboolean
+quit_control_loop_cb (GMainLoop *loop)
+{
+  g_main_loop_quit (loop);
+
+  return G_SOURCE_REMOVE;
+}
+
 static void
 manette_steam_deck_driver_finalize (GObject *object)
 {
   ManetteSteamDeckDriver *self = MANETTE_STEAM_DECK_DRIVER (object);
 
-  g_clear_handle_id (&self->rumble_timeout, g_source_remove);
+  if (self->control_thread) {
+    g_autoptr (GSource) quit_source = NULL;
+
+    /* Quit from the loop itself, as quitting it before it runs would be
+     * ignored. Not through g_main_context_invoke(), which would run the
+     * callback right here if the control thread didn't acquire the context
+     * yet.
+     */
+    quit_source = g_idle_source_new ();
+    g_source_set_priority (quit_source, G_PRIORITY_HIGH);
+    g_source_set_callback (quit_source, G_SOURCE_FUNC (quit_control_loop_cb),
+                           self->control_loop, NULL);
+    g_source_attach (quit_source, self->control_context);
+
+    g_thread_join (self->control_thread);
+  }
+
+  g_clear_pointer (&self->control_loop, g_main_loop_unref);
+  g_clear_pointer (&self->control_context, g_main_context_unref);
 
   G_OBJECT_CLASS (manette_steam_deck_driver_parent_class)->finalize (object);
 }
@@ -685,6 +790,8 @@ manette_steam_deck_driver_class_init (ManetteSteamDeckDriverClass *klass)
 static void
 manette_steam_deck_driver_init (ManetteSteamDeckDriver *self)
 {
+  self->control_context = g_main_context_new ();
+  self->control_loop = g_main_loop_new (self->control_context, FALSE);
 }
 
 static gboolean
@@ -700,6 +807,10 @@ manette_steam_deck_driver_initialize (ManetteHidDriver *driver)
   if (!disable_lizard_mode (self))
     return FALSE;
 
+  self->control_thread = g_thread_new ("manette-steam-deck",
+                                       (GThreadFunc) control_thread_func,
+                                       self);
+
   return TRUE;
 }
 
@@ -759,47 +870,26 @@ manette_steam_deck_driver_has_axis (ManetteHidDriver *driver,
   }
 }
 
-static guint
-manette_steam_deck_driver_get_poll_rate (ManetteHidDriver *driver)
-{
-  return 4;
-}
-
 static void
-manette_steam_deck_driver_poll (ManetteHidDriver *driver,
-                                gint64            time)
+manette_steam_deck_driver_handle_report (ManetteHidDriver *driver,
+                                         const guint8     *data,
+                                         gsize             length,
+                                         gint64            time)
 {
   ManetteSteamDeckDriver *self = MANETTE_STEAM_DECK_DRIVER (driver);
   guint8 buffer[64];
   InputReport *report = (InputReport *) buffer;
-  int read;
-
-  if (self->lizard_watchdog_counter++ > 200) {
-    self->lizard_watchdog_counter = 0;
-    disable_lizard_mode (self);
-  }
 
   memset (buffer, 0, sizeof (buffer));
+  memcpy (buffer, data, MIN (length, sizeof (buffer)));
 
-  while (TRUE) {
-    read = hid_read (self->hid, buffer, sizeof (buffer));
-
-    if (read < 0) {
-      g_debug ("Failed to get input report: %ls", hid_error (self->hid));
-      return;
-    }
-
-    if (read == 0)
-      break;
-
-    if (report->header.version != INPUT_REPORT_VERSION ||
-        report->header.type != ID_CONTROLLER_DECK_STATE ||
-        report->header.length != 64) {
-      continue;
-    }
-
-    handle_state (self, &report->deck_state, time);
+  if (report->header.version != INPUT_REPORT_VERSION ||
+      report->header.type != ID_CONTROLLER_DECK_STATE ||
+      report->header.length != 64) {
+    return;
   }
+
+  handle_state (self, &report->deck_state, time);
 }
 
 static gboolean
@@ -808,38 +898,41 @@ manette_steam_deck_driver_has_rumble (ManetteHidDriver *driver)
   return TRUE;
 }
 
+typedef struct {
+  ManetteSteamDeckDriver *self;
+  guint16 strong_magnitude;
+  guint16 weak_magnitude;
+  guint16 milliseconds;
+} RumbleData;
+
 static gboolean
-send_rumble (ManetteSteamDeckDriver *self,
-             guint16                 left_speed,
-             guint16                 right_speed)
+stop_rumble_cb (ManetteSteamDeckDriver *self)
 {
-  guint8 buffer[sizeof (RumbleReport) + 1] = { 0 };
-  RumbleReport *report = (RumbleReport *) (buffer + 1);
+  g_clear_pointer (&self->rumble_source, g_source_unref);
 
-  report->header.type = ID_TRIGGER_RUMBLE_CMD;
-  report->rumble_type = 0;
-  report->intensity = HAPTIC_INTENSITY_SYSTEM;
-  report->left_motor_speed = left_speed;
-  report->right_motor_speed = right_speed;
-  report->left_gain = 2;
-  report->right_gain = 0;
+  send_rumble (self, 0, 0);
 
-  int r = hid_send_feature_report (self->hid, buffer, sizeof (buffer));
-  if (r < 0) {
-    g_warning ("Failed to rumble: %ls", hid_error (self->hid));
+  return G_SOURCE_REMOVE;
+}
 
-    return FALSE;
+static gboolean
+rumble_cb (RumbleData *data)
+{
+  ManetteSteamDeckDriver *self = data->self;
+
+  if (self->rumble_source) {
+    g_source_destroy (self->rumble_source);
+    g_clear_pointer (&self->rumble_source, g_source_unref);
   }
 
-  return TRUE;
-}
+  if (!send_rumble (self, data->strong_magnitude, data->weak_magnitude))
+    return G_SOURCE_REMOVE;
 
-static void
-stop_rumble_cb (ManetteSteamDeckDriver *self)
-{
-  self->rumble_timeout = 0;
+  self->rumble_source = g_timeout_source_new (data->milliseconds);
+  g_source_set_callback (self->rumble_source, G_SOURCE_FUNC (stop_rumble_cb), self, NULL);
+  g_source_attach (self->rumble_source, self->control_context);
 
-  send_rumble (self, 0, 0);
+  return G_SOURCE_REMOVE;
 }
 
 static gboolean
@@ -849,22 +942,35 @@ manette_steam_deck_driver_rumble (ManetteHidDriver *driver,
                                   guint16           milliseconds)
 {
   ManetteSteamDeckDriver *self = MANETTE_STEAM_DECK_DRIVER (driver);
+  RumbleData *data;
 
-  if (!send_rumble (self, strong_magnitude, weak_magnitude)) {
-    g_warning ("Failed to rumble.");
-
+  if (!self->control_thread)
     return FALSE;
-  }
 
-  g_clear_handle_id (&self->rumble_timeout, g_source_remove);
+  data = g_new0 (RumbleData, 1);
+  data->self = self;
+  data->strong_magnitude = strong_magnitude;
+  data->weak_magnitude = weak_magnitude;
+  data->milliseconds = milliseconds;
 
-  self->rumble_timeout = g_timeout_add_once (milliseconds,
-                                             (GSourceOnceFunc) stop_rumble_cb,
-                                             self);
+  /* Sent from the control thread, failures are only reported there */
+  g_main_context_invoke_full (self->control_context,
+                              G_PRIORITY_DEFAULT,
+                              G_SOURCE_FUNC (rumble_cb),
+                              data,
+                              g_free);
 
   return TRUE;
 }
 
+static ManetteHidDriverEventSink *
+manette_steam_deck_driver_get_event_sink (ManetteHidDriver *driver)
+{
+  ManetteSteamDeckDriver *self = MANETTE_STEAM_DECK_DRIVER (driver);
+
+  return &self->event_sink;
+}
+
 static void
 manette_steam_deck_hid_driver_init (ManetteHidDriverInterface *iface)
 {
@@ -872,10 +978,10 @@ manette_steam_deck_hid_driver_init (ManetteHidDriverInterface *iface)
   iface->get_name = manette_steam_deck_driver_get_name;
   iface->has_button = manette_steam_deck_driver_has_button;
   iface->has_axis = manette_steam_deck_driver_has_axis;
-  iface->get_poll_rate = manette_steam_deck_driver_get_poll_rate;
-  iface->poll = manette_steam_deck_driver_poll;
+  iface->handle_report = manette_steam_deck_driver_handle_report;
   iface->has_rumble = manette_steam_deck_driver_has_rumble;
   iface->rumble = manette_steam_deck_driver_rumble;
+  iface->get_event_sink = manette_steam_deck_driver_get_event_sink;
 }
 
 ManetteHidDriver *
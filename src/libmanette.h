@@ -25,6 +25,7 @@ G_BEGIN_DECLS
 #define __MANETTE_INSIDE__
 # include "manette-device.h"
 # include "manette-device-type.h"
+# include "manette-event.h"
 # include "manette-inputs.h"
 # include "manette-monitor.h"
 # include "manette-version.h"
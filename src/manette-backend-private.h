@@ -22,8 +22,10 @@
 # error "This file is private, only <libmanette.h> can be included directly."
 #endif
 
+#include <gio/gio.h>
 #include <glib-object.h>
 
+#include "manette-event-ring-private.h"
 #include "manette-inputs.h"
 #include "manette-mapping-private.h"
 
@@ -33,12 +35,24 @@ G_BEGIN_DECLS
 
 G_DECLARE_INTERFACE (ManetteBackend, manette_backend, MANETTE, BACKEND, GObject)
 
+typedef void (* ManetteBackendEventFunc) (const ManetteInputEvent *event,
+                                          gpointer                 user_data);
+
+/* Embedded in the backends, which emit their events into it directly */
+typedef struct {
+  ManetteBackendEventFunc func;
+  gpointer user_data;
+  int unmapped_disabled;
+} ManetteBackendEventSink;
+
 struct _ManetteBackendInterface
 {
   GTypeInterface parent;
 
   gboolean (* initialize) (ManetteBackend *self);
 
+  GSource * (* create_source) (ManetteBackend *self);
+
   const char * (* get_name) (ManetteBackend *self);
   int (* get_vendor_id) (ManetteBackend *self);
   int (* get_product_id) (ManetteBackend *self);
@@ -62,9 +76,22 @@ struct _ManetteBackendInterface
                        guint16         strong_magnitude,
                        guint16         weak_magnitude,
                        guint16         milliseconds);
+
+  guint (* get_n_dropped_frames) (ManetteBackend *self);
+
+  ManetteBackendEventSink * (* get_event_sink) (ManetteBackend *self);
 };
 
-gboolean manette_backend_initialize (ManetteBackend *self);
+gboolean manette_backend_initialize        (ManetteBackend       *self);
+void     manette_backend_initialize_async  (ManetteBackend       *self,
+                                            GCancellable         *cancellable,
+                                            GAsyncReadyCallback   callback,
+                                            gpointer              user_data);
+gboolean manette_backend_initialize_finish (ManetteBackend       *self,
+                                            GAsyncResult         *result,
+                                            GError              **error);
+
+GSource *manette_backend_create_source (ManetteBackend *self);
 
 const char *manette_backend_get_name (ManetteBackend *self);
 int manette_backend_get_vendor_id (ManetteBackend *self);
@@ -90,26 +117,45 @@ gboolean manette_backend_rumble     (ManetteBackend *self,
                                      guint16         weak_magnitude,
                                      guint16         milliseconds);
 
-void manette_backend_emit_button_event (ManetteBackend *self,
-                                        guint64         time,
-                                        ManetteButton   button,
-                                        gboolean        pressed);
-void manette_backend_emit_axis_event   (ManetteBackend *self,
-                                        guint64         time,
-                                        ManetteAxis     axis,
-                                        double          value);
-
-void manette_backend_emit_unmapped_button_event   (ManetteBackend *self,
-                                                   guint64         time,
-                                                   guint           index,
-                                                   gboolean        pressed);
-void manette_backend_emit_unmapped_absolute_event (ManetteBackend *self,
-                                                   guint64         time,
-                                                   guint           index,
-                                                   double          value);
-void manette_backend_emit_unmapped_hat_event      (ManetteBackend *self,
-                                                   guint64         time,
-                                                   guint           index,
-                                                   gint8           value);
+guint manette_backend_get_n_dropped_frames (ManetteBackend *self);
+
+ManetteBackendEventSink *manette_backend_get_event_sink (ManetteBackend *self);
+
+void manette_backend_set_event_func (ManetteBackend          *self,
+                                     ManetteBackendEventFunc  func,
+                                     gpointer                 user_data);
+
+void manette_backend_set_unmapped_events_enabled (ManetteBackend *self,
+                                                  gboolean        enabled);
+
+void manette_backend_event_sink_emit (ManetteBackendEventSink *sink,
+                                      const ManetteInputEvent *event);
+
+gboolean manette_backend_event_sink_wants_unmapped_events (ManetteBackendEventSink *sink);
+
+void manette_backend_event_sink_emit_button (ManetteBackendEventSink *sink,
+                                             guint64                  time,
+                                             ManetteButton            button,
+                                             gboolean                 pressed);
+void manette_backend_event_sink_emit_axis   (ManetteBackendEventSink *sink,
+                                             guint64                  time,
+                                             ManetteAxis              axis,
+                                             double                   value);
+
+void manette_backend_event_sink_emit_unmapped_button   (ManetteBackendEventSink *sink,
+                                                        guint64                  time,
+                                                        guint                    index,
+                                                        gboolean                 pressed);
+void manette_backend_event_sink_emit_unmapped_absolute (ManetteBackendEventSink *sink,
+                                                        guint64                  time,
+                                                        guint                    index,
+                                                        double                   value);
+void manette_backend_event_sink_emit_unmapped_hat      (ManetteBackendEventSink *sink,
+                                                        guint64                  time,
+                                                        guint                    index,
+                                                        gint8                    value);
+
+void manette_backend_event_sink_emit_frame (ManetteBackendEventSink *sink,
+                                            guint64                  time);
 
 G_END_DECLS
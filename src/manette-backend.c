@@ -22,69 +22,9 @@
 
 G_DEFINE_INTERFACE (ManetteBackend, manette_backend, G_TYPE_OBJECT)
 
-enum {
-  SIGNAL_BUTTON_EVENT,
-  SIGNAL_AXIS_EVENT,
-  SIGNAL_UNMAPPED_BUTTON_EVENT,
-  SIGNAL_UNMAPPED_ABSOLUTE_EVENT,
-  SIGNAL_UNMAPPED_HAT_EVENT,
-  SIGNAL_LAST_SIGNAL,
-};
-
-static guint signals[SIGNAL_LAST_SIGNAL];
-
 static void
 manette_backend_default_init (ManetteBackendInterface *iface)
 {
-  signals[SIGNAL_BUTTON_EVENT] =
-    g_signal_new ("button-event",
-                  G_TYPE_FROM_INTERFACE (iface),
-                  G_SIGNAL_RUN_FIRST,
-                  0,
-                  NULL, NULL, NULL,
-                  G_TYPE_NONE,
-                  3,
-                  G_TYPE_UINT64, MANETTE_TYPE_BUTTON, G_TYPE_BOOLEAN);
-
-  signals[SIGNAL_AXIS_EVENT] =
-    g_signal_new ("axis-event",
-                  G_TYPE_FROM_INTERFACE (iface),
-                  G_SIGNAL_RUN_FIRST,
-                  0,
-                  NULL, NULL, NULL,
-                  G_TYPE_NONE,
-                  3,
-                  G_TYPE_UINT64, MANETTE_TYPE_AXIS, G_TYPE_DOUBLE);
-
-  signals[SIGNAL_UNMAPPED_BUTTON_EVENT] =
-    g_signal_new ("unmapped-button-event",
-                  G_TYPE_FROM_INTERFACE (iface),
-                  G_SIGNAL_RUN_FIRST,
-                  0,
-                  NULL, NULL, NULL,
-                  G_TYPE_NONE,
-                  3,
-                  G_TYPE_UINT64, G_TYPE_UINT, G_TYPE_BOOLEAN);
-
-  signals[SIGNAL_UNMAPPED_ABSOLUTE_EVENT] =
-    g_signal_new ("unmapped-absolute-event",
-                  G_TYPE_FROM_INTERFACE (iface),
-                  G_SIGNAL_RUN_FIRST,
-                  0,
-                  NULL, NULL, NULL,
-                  G_TYPE_NONE,
-                  3,
-                  G_TYPE_UINT64, G_TYPE_UINT, G_TYPE_DOUBLE);
-
-  signals[SIGNAL_UNMAPPED_HAT_EVENT] =
-    g_signal_new ("unmapped-hat-event",
-                  G_TYPE_FROM_INTERFACE (iface),
-                  G_SIGNAL_RUN_FIRST,
-                  0,
-                  NULL, NULL, NULL,
-                  G_TYPE_NONE,
-                  3,
-                  G_TYPE_UINT64, G_TYPE_UINT, G_TYPE_CHAR);
 }
 
 gboolean
@@ -101,6 +41,71 @@ manette_backend_initialize (ManetteBackend *self)
   return iface->initialize (self);
 }
 
+static void
+initialize_thread (GTask          *task,
+                   ManetteBackend *self,
+                   gpointer        task_data,
+                   GCancellable   *cancellable)
+{
+  if (!manette_backend_initialize (self)) {
+    g_task_return_new_error (task, G_IO_ERROR, G_IO_ERROR_FAILED,
+                             "Failed to initialize the device");
+
+    return;
+  }
+
+  g_task_return_boolean (task, TRUE);
+}
+
+/* Initializes the backend on a worker thread, as that can block. If
+ * @cancellable is cancelled, e.g. because the device was unplugged, @callback
+ * is called with %G_IO_ERROR_CANCELLED once the initialization is over, and
+ * the backend must then be dropped.
+ */
+void
+manette_backend_initialize_async (ManetteBackend      *self,
+                                  GCancellable        *cancellable,
+                                  GAsyncReadyCallback  callback,
+                                  gpointer             user_data)
+{
+  g_autoptr (GTask) task = NULL;
+
+  g_assert (MANETTE_IS_BACKEND (self));
+  g_assert (cancellable == NULL || G_IS_CANCELLABLE (cancellable));
+
+  task = g_task_new (self, cancellable, callback, user_data);
+  g_task_set_source_tag (task, manette_backend_initialize_async);
+  g_task_run_in_thread (task, (GTaskThreadFunc) initialize_thread);
+}
+
+gboolean
+manette_backend_initialize_finish (ManetteBackend  *self,
+                                   GAsyncResult    *result,
+                                   GError         **error)
+{
+  g_assert (MANETTE_IS_BACKEND (self));
+  g_assert (g_task_is_valid (result, self));
+
+  return g_task_propagate_boolean (G_TASK (result), error);
+}
+
+/* The returned source reads and emits the events of the backend once attached
+ * to a context, which must be done after initializing it.
+ */
+GSource *
+manette_backend_create_source (ManetteBackend *self)
+{
+  ManetteBackendInterface *iface;
+
+  g_assert (MANETTE_IS_BACKEND (self));
+
+  iface = MANETTE_BACKEND_GET_IFACE (self);
+
+  g_assert (iface->create_source);
+
+  return iface->create_source (self);
+}
+
 const char *
 manette_backend_get_name (ManetteBackend *self)
 {
@@ -265,61 +270,216 @@ manette_backend_rumble (ManetteBackend *self,
   return iface->rumble (self, strong_magnitude, weak_magnitude, milliseconds);
 }
 
-void
-manette_backend_emit_button_event (ManetteBackend *self,
-                                   guint64         time,
-                                   ManetteButton   button,
-                                   gboolean        pressed)
+/* Backends that can't detect dropped frames don't implement it. */
+guint
+manette_backend_get_n_dropped_frames (ManetteBackend *self)
+{
+  ManetteBackendInterface *iface;
+
+  g_assert (MANETTE_IS_BACKEND (self));
+
+  iface = MANETTE_BACKEND_GET_IFACE (self);
+
+  if (!iface->get_n_dropped_frames)
+    return 0;
+
+  return iface->get_n_dropped_frames (self);
+}
+
+/*
+ * manette_backend_get_event_sink:
+ * @self: a backend
+ *
+ * Gets where @self emits its events. Backends embed it and emit into it
+ * directly, so emitting an event looks nothing up.
+ *
+ * Returns: (transfer none): the event sink of @self
+ */
+ManetteBackendEventSink *
+manette_backend_get_event_sink (ManetteBackend *self)
 {
+  ManetteBackendInterface *iface;
+
   g_assert (MANETTE_IS_BACKEND (self));
 
-  pressed = !!pressed;
+  iface = MANETTE_BACKEND_GET_IFACE (self);
+
+  g_assert (iface->get_event_sink);
 
-  g_signal_emit (self, signals[SIGNAL_BUTTON_EVENT], 0, time, button, pressed);
+  return iface->get_event_sink (self);
 }
 
+/*
+ * manette_backend_set_event_func:
+ * @self: a backend
+ * @func: (nullable): the function to call on each event
+ * @user_data: the data to pass to @func
+ *
+ * Sets the function the events of @self are passed to, on the thread reading
+ * them. It's called directly rather than through signals, as that's done for
+ * every single event.
+ */
 void
-manette_backend_emit_axis_event (ManetteBackend *self,
-                                 guint64         time,
-                                 ManetteAxis     axis,
-                                 double          value)
+manette_backend_set_event_func (ManetteBackend          *self,
+                                ManetteBackendEventFunc  func,
+                                gpointer                 user_data)
 {
+  ManetteBackendEventSink *sink;
+
   g_assert (MANETTE_IS_BACKEND (self));
 
-  g_signal_emit (self, signals[SIGNAL_AXIS_EVENT], 0, time, axis, value);
+  sink = manette_backend_get_event_sink (self);
+  sink->func = func;
+  sink->user_data = user_data;
 }
 
+/*
+ * manette_backend_set_unmapped_events_enabled:
+ * @self: a backend
+ * @enabled: whether to pass the unmapped button and absolute events
+ *
+ * Sets whether the unmapped button and absolute events are passed to the event
+ * function, they are by default. Nothing but a mapping editor usually needs
+ * them, while they double the number of events.
+ *
+ * The unmapped hat events are always passed, as they update the state of the
+ * device.
+ */
 void
-manette_backend_emit_unmapped_button_event (ManetteBackend *self,
-                                            guint64         time,
-                                            guint           index,
-                                            gboolean        pressed)
+manette_backend_set_unmapped_events_enabled (ManetteBackend *self,
+                                             gboolean        enabled)
 {
+  ManetteBackendEventSink *sink;
+
   g_assert (MANETTE_IS_BACKEND (self));
 
-  pressed = !!pressed;
+  sink = manette_backend_get_event_sink (self);
+  g_assert (sink->func != NULL);
 
-  g_signal_emit (self, signals[SIGNAL_UNMAPPED_BUTTON_EVENT], 0, time, index, pressed);
+  g_atomic_int_set (&sink->unmapped_disabled, !enabled);
 }
 
+/* The event times are in microseconds on the monotonic clock, like
+ * g_get_monotonic_time(), whatever the backend.
+ */
 void
-manette_backend_emit_unmapped_absolute_event (ManetteBackend *self,
-                                              guint64         time,
-                                              guint           index,
-                                              double          value)
+manette_backend_event_sink_emit (ManetteBackendEventSink *sink,
+                                 const ManetteInputEvent *event)
 {
-  g_assert (MANETTE_IS_BACKEND (self));
+  g_assert (sink != NULL);
 
-  g_signal_emit (self, signals[SIGNAL_UNMAPPED_ABSOLUTE_EVENT], 0, time, index, value);
+  if (G_LIKELY (sink->func))
+    sink->func (event, sink->user_data);
+}
+
+/* Lets the backends skip computing the unmapped events nobody wants */
+gboolean
+manette_backend_event_sink_wants_unmapped_events (ManetteBackendEventSink *sink)
+{
+  g_assert (sink != NULL);
+
+  return sink->func && !g_atomic_int_get (&sink->unmapped_disabled);
+}
+
+static inline void
+emit_unmapped_event (ManetteBackendEventSink *sink,
+                     const ManetteInputEvent *event)
+{
+  if (manette_backend_event_sink_wants_unmapped_events (sink))
+    sink->func (event, sink->user_data);
 }
 
 void
-manette_backend_emit_unmapped_hat_event (ManetteBackend *self,
-                                         guint64         time,
-                                         guint           index,
-                                         gint8           value)
+manette_backend_event_sink_emit_button (ManetteBackendEventSink *sink,
+                                        guint64                  time,
+                                        ManetteButton            button,
+                                        gboolean                 pressed)
 {
-  g_assert (MANETTE_IS_BACKEND (self));
+  ManetteInputEvent event = {
+    .type = MANETTE_INPUT_EVENT_BUTTON,
+    .index = button,
+    .time = time,
+    .pressed = !!pressed,
+  };
+
+  manette_backend_event_sink_emit (sink, &event);
+}
+
+void
+manette_backend_event_sink_emit_axis (ManetteBackendEventSink *sink,
+                                      guint64                  time,
+                                      ManetteAxis              axis,
+                                      double                   value)
+{
+  ManetteInputEvent event = {
+    .type = MANETTE_INPUT_EVENT_AXIS,
+    .index = axis,
+    .time = time,
+    .value = value,
+  };
+
+  manette_backend_event_sink_emit (sink, &event);
+}
+
+void
+manette_backend_event_sink_emit_unmapped_button (ManetteBackendEventSink *sink,
+                                                 guint64                  time,
+                                                 guint                    index,
+                                                 gboolean                 pressed)
+{
+  ManetteInputEvent event = {
+    .type = MANETTE_INPUT_EVENT_UNMAPPED_BUTTON,
+    .index = index,
+    .time = time,
+    .pressed = !!pressed,
+  };
+
+  emit_unmapped_event (sink, &event);
+}
+
+void
+manette_backend_event_sink_emit_unmapped_absolute (ManetteBackendEventSink *sink,
+                                                   guint64                  time,
+                                                   guint                    index,
+                                                   double                   value)
+{
+  ManetteInputEvent event = {
+    .type = MANETTE_INPUT_EVENT_UNMAPPED_ABSOLUTE,
+    .index = index,
+    .time = time,
+    .value = value,
+  };
+
+  emit_unmapped_event (sink, &event);
+}
+
+void
+manette_backend_event_sink_emit_unmapped_hat (ManetteBackendEventSink *sink,
+                                              guint64                  time,
+                                              guint                    index,
+                                              gint8                    value)
+{
+  ManetteInputEvent event = {
+    .type = MANETTE_INPUT_EVENT_UNMAPPED_HAT,
+    .index = index,
+    .time = time,
+    .hat_value = value,
+  };
+
+  manette_backend_event_sink_emit (sink, &event);
+}
+
+/* Marks the end of a hardware frame, the events emitted since the previous
+ * frame are delivered together.
+ */
+void
+manette_backend_event_sink_emit_frame (ManetteBackendEventSink *sink,
+                                       guint64                  time)
+{
+  ManetteInputEvent event = {
+    .type = MANETTE_INPUT_EVENT_FRAME,
+    .time = time,
+  };
 
-  g_signal_emit (self, signals[SIGNAL_UNMAPPED_HAT_EVENT], 0, time, index, value);
+  manette_backend_event_sink_emit (sink, &event);
 }
@@ -24,17 +24,23 @@
 
 #include "manette-device.h"
 #include "manette-backend-private.h"
+#include "manette-event-queue-private.h"
+#include "manette-input-thread-private.h"
 #include "manette-mapping-private.h"
 
 G_BEGIN_DECLS
 
 ManetteDevice *manette_device_new (ManetteBackend  *backend,
                                    GError         **error);
+void manette_device_start (ManetteDevice      *self,
+                           ManetteInputThread *input_thread);
 int manette_device_get_product_id (ManetteDevice *self);
 int manette_device_get_vendor_id (ManetteDevice *self);
 int manette_device_get_bustype_id (ManetteDevice *self);
 int manette_device_get_version_id (ManetteDevice *self);
 void manette_device_set_mapping (ManetteDevice  *self,
                                  ManetteMapping *mapping);
+void manette_device_set_event_queue (ManetteDevice     *self,
+                                     ManetteEventQueue *queue);
 
 G_END_DECLS
@@ -27,6 +27,8 @@
 #include <unistd.h>
 #include "manette-backend-private.h"
 #include "manette-device-type-private.h"
+#include "manette-event-ring-private.h"
+#include "manette-marshal.h"
 #include "manette-mapping-manager-private.h"
 
 /**
@@ -34,23 +36,88 @@
  *
  * An object representing a physical gamepad.
  *
+ * The unmapped events are emitted by default. Only mapping editors usually
+ * need them, so other applications can skip them with
+ * [method@Device.set_unmapped_events_enabled].
+ *
  * See also: [class@Monitor].
  */
 
+/* The events a frame can hold, a longer frame gets split into several */
+#define MAX_FRAME_EVENTS 64
+
+/* What a device has, probed once when it's created so that querying it
+ * doesn't reach the backend. The mapped buttons and axes are recomputed when
+ * the mapping changes.
+ */
+typedef struct {
+  int vendor_id;
+  int product_id;
+  int bustype_id;
+  int version_id;
+  gboolean has_rumble;
+  guint64 unmapped_buttons;
+  guint8 unmapped_axes;
+  guint64 buttons;
+  guint8 axes;
+} Capabilities;
+
 struct _ManetteDevice
 {
   GObject parent_instance;
 
+  guint id;
   char *guid;
   ManetteBackend *backend;
+  ManetteMappingManager *mapping_manager;
 
   ManetteDeviceType device_type;
+  Capabilities capabilities;
 
   guint64 current_event_time;
+  ManetteDeviceState state;
+
+  /* The monitor's queue the events are copied to for polling */
+  ManetteEventQueue *event_queue;
+
+  /* Whether the backend passes the unmapped button and absolute events */
+  gboolean unmapped_events_enabled;
+
+  /* Called before the signals, without their marshalling */
+  gboolean has_sink;
+  ManetteDeviceEventSink sink;
+  gpointer sink_data;
+  GDestroyNotify sink_destroy;
+
+  /* The events of the current frame, delivered when it ends */
+  ManetteInputEvent frame_events[MAX_FRAME_EVENTS];
+  gsize n_frame_events;
+
+  /* The events of the frame being delivered, see
+   * manette_device_get_frame_events()
+   */
+  const ManetteInputEvent *delivered_events;
+  gsize n_delivered_events;
+
+  /* The source reading the backend's events, and if they are read on an
+   * input thread, the ring passing them to the context the device was
+   * started on.
+   */
+  ManetteInputThread *input_thread;
+  GSource *backend_source;
+  GSource *event_ring;
 };
 
+/* The events the input thread can queue before the owner's context
+ * dispatches them, further events are dropped.
+ */
+#define EVENT_RING_CAPACITY 1024
+
 G_DEFINE_FINAL_TYPE (ManetteDevice, manette_device, G_TYPE_OBJECT)
 
+G_STATIC_ASSERT (MANETTE_BUTTON_TOUCHPAD < 64);
+G_STATIC_ASSERT (MANETTE_AXIS_RIGHT_TRIGGER < MANETTE_DEVICE_N_AXES);
+
 enum {
   SIG_DISCONNECTED,
   SIG_BUTTON_PRESSED,
@@ -60,11 +127,15 @@ enum {
   SIG_UNMAPPED_BUTTON_RELEASED,
   SIG_UNMAPPED_ABSOLUTE_AXIS_CHANGED,
   SIG_UNMAPPED_HAT_AXIS_CHANGED,
+  SIG_FRAME,
   N_SIGNALS,
 };
 
 static guint signals[N_SIGNALS];
 
+/* The identifiers of the devices, 0 is never used */
+static int last_id;
+
 /* Private */
 
 static void
@@ -72,8 +143,28 @@ manette_device_finalize (GObject *object)
 {
   ManetteDevice *self = (ManetteDevice *)object;
 
+  if (self->backend_source) {
+    if (self->input_thread)
+      manette_input_thread_destroy_source (self->input_thread, self->backend_source);
+    else
+      g_source_destroy (self->backend_source);
+    g_clear_pointer (&self->backend_source, g_source_unref);
+  }
+
+  if (self->event_ring) {
+    g_source_destroy (self->event_ring);
+    g_clear_pointer (&self->event_ring, g_source_unref);
+  }
+
+  g_clear_pointer (&self->input_thread, manette_input_thread_unref);
   g_clear_pointer (&self->guid, g_free);
+  if (self->sink_destroy)
+    self->sink_destroy (self->sink_data);
+  g_clear_pointer (&self->event_queue, manette_event_queue_unref);
+  if (self->backend)
+    manette_backend_set_event_func (self->backend, NULL, NULL);
   g_clear_object (&self->backend);
+  g_clear_object (&self->mapping_manager);
 
   G_OBJECT_CLASS (manette_device_parent_class)->finalize (object);
 }
@@ -144,9 +235,12 @@ manette_device_class_init (ManetteDeviceClass *klass)
                   MANETTE_TYPE_DEVICE,
                   G_SIGNAL_RUN_LAST,
                   0, NULL, NULL,
-                  NULL,
+                  manette_marshal_VOID__ENUM_DOUBLE,
                   G_TYPE_NONE, 2,
                   MANETTE_TYPE_AXIS, G_TYPE_DOUBLE);
+  g_signal_set_va_marshaller (signals[SIG_ABSOLUTE_AXIS_CHANGED],
+                              G_TYPE_FROM_CLASS (klass),
+                              manette_marshal_VOID__ENUM_DOUBLEv);
 
   /**
    * ManetteDevice::unmapped-button-pressed:
@@ -193,9 +287,12 @@ manette_device_class_init (ManetteDeviceClass *klass)
                   MANETTE_TYPE_DEVICE,
                   G_SIGNAL_RUN_LAST,
                   0, NULL, NULL,
-                  NULL,
+                  manette_marshal_VOID__UINT_DOUBLE,
                   G_TYPE_NONE, 2,
                   G_TYPE_UINT, G_TYPE_DOUBLE);
+  g_signal_set_va_marshaller (signals[SIG_UNMAPPED_ABSOLUTE_AXIS_CHANGED],
+                              G_TYPE_FROM_CLASS (klass),
+                              manette_marshal_VOID__UINT_DOUBLEv);
 
   /**
    * ManetteDevice::unmapped-hat-axis-changed:
@@ -210,9 +307,36 @@ manette_device_class_init (ManetteDeviceClass *klass)
                   MANETTE_TYPE_DEVICE,
                   G_SIGNAL_RUN_LAST,
                   0, NULL, NULL,
-                  NULL,
+                  manette_marshal_VOID__UINT_CHAR,
                   G_TYPE_NONE, 2,
                   G_TYPE_UINT, G_TYPE_CHAR);
+  g_signal_set_va_marshaller (signals[SIG_UNMAPPED_HAT_AXIS_CHANGED],
+                              G_TYPE_FROM_CLASS (klass),
+                              manette_marshal_VOID__UINT_CHARv);
+
+  /**
+   * ManetteDevice::frame:
+   * @self: a device
+   *
+   * Emitted at the end of each hardware frame, after the signals of the inputs
+   * that changed during it.
+   *
+   * The state of @self is updated for the whole frame before any of these
+   * signals is emitted, so sampling it with [method@Device.get_state] gives
+   * consistent values, e.g. for both axes of a stick.
+   *
+   * Applications can listen to this signal alone: the inputs that changed
+   * during the frame are given by [method@Device.get_frame_events], which
+   * has every transition, even a button pressed and released within the
+   * frame. A frame with too many changes is delivered as several frames.
+   */
+  signals[SIG_FRAME] =
+    g_signal_new ("frame",
+                  MANETTE_TYPE_DEVICE,
+                  G_SIGNAL_RUN_LAST,
+                  0, NULL, NULL,
+                  g_cclosure_marshal_VOID__VOID,
+                  G_TYPE_NONE, 0);
 }
 
 static void
@@ -230,65 +354,314 @@ compute_guid_string (ManetteDevice *self)
                           GINT_TO_BE (manette_device_get_version_id (self)));
 }
 
+static ManetteMappingManager *
+get_mapping_manager (ManetteDevice *self)
+{
+  if (self->mapping_manager == NULL)
+    self->mapping_manager = manette_mapping_manager_dup_default ();
+
+  return self->mapping_manager;
+}
+
+static void
+update_state (ManetteDevice           *self,
+              const ManetteInputEvent *event)
+{
+  self->state.time = event->time;
+
+  switch (event->type) {
+  case MANETTE_INPUT_EVENT_BUTTON:
+    if (event->pressed)
+      self->state.buttons |= G_GUINT64_CONSTANT (1) << event->index;
+    else
+      self->state.buttons &= ~(G_GUINT64_CONSTANT (1) << event->index);
+
+    break;
+  case MANETTE_INPUT_EVENT_AXIS:
+    self->state.axes[event->index] = event->value;
+
+    break;
+  case MANETTE_INPUT_EVENT_UNMAPPED_HAT:
+    if (event->index < MANETTE_DEVICE_N_HATS)
+      self->state.hats[event->index] = event->hat_value;
+
+    break;
+  default:
+    break;
+  }
+}
+
+static void
+sink_event (ManetteDevice           *self,
+            const ManetteInputEvent *event)
+{
+  const ManetteDeviceEventSink *sink = &self->sink;
+
+  switch (event->type) {
+  case MANETTE_INPUT_EVENT_BUTTON:
+    if (sink->button_event)
+      sink->button_event (self, event->time, event->index, event->pressed, self->sink_data);
+
+    break;
+  case MANETTE_INPUT_EVENT_AXIS:
+    if (sink->absolute_axis_event)
+      sink->absolute_axis_event (self, event->time, event->index, event->value, self->sink_data);
+
+    break;
+  case MANETTE_INPUT_EVENT_UNMAPPED_BUTTON:
+    if (sink->unmapped_button_event)
+      sink->unmapped_button_event (self, event->time, event->index, event->pressed, self->sink_data);
+
+    break;
+  case MANETTE_INPUT_EVENT_UNMAPPED_ABSOLUTE:
+    if (sink->unmapped_absolute_axis_event)
+      sink->unmapped_absolute_axis_event (self, event->time, event->index, event->value, self->sink_data);
+
+    break;
+  case MANETTE_INPUT_EVENT_UNMAPPED_HAT:
+    if (sink->unmapped_hat_axis_event)
+      sink->unmapped_hat_axis_event (self, event->time, event->index, event->hat_value, self->sink_data);
+
+    break;
+  case MANETTE_INPUT_EVENT_FRAME:
+    if (sink->frame)
+      sink->frame (self, event->time, self->sink_data);
+
+    break;
+  default:
+    g_assert_not_reached ();
+  }
+}
+
+static void
+convert_event (ManetteDevice           *self,
+               const ManetteInputEvent *event,
+               ManetteEvent            *converted_event)
+{
+  *converted_event = (ManetteEvent) {
+    .device_id = self->id,
+    .time = event->time,
+    .index = event->index,
+    .value = event->value,
+  };
+
+  switch (event->type) {
+  case MANETTE_INPUT_EVENT_BUTTON:
+    converted_event->type = event->pressed ? MANETTE_EVENT_BUTTON_PRESSED :
+                                             MANETTE_EVENT_BUTTON_RELEASED;
+    break;
+  case MANETTE_INPUT_EVENT_AXIS:
+    converted_event->type = MANETTE_EVENT_ABSOLUTE_AXIS_CHANGED;
+    break;
+  case MANETTE_INPUT_EVENT_UNMAPPED_BUTTON:
+    converted_event->type = event->pressed ? MANETTE_EVENT_UNMAPPED_BUTTON_PRESSED :
+                                             MANETTE_EVENT_UNMAPPED_BUTTON_RELEASED;
+    break;
+  case MANETTE_INPUT_EVENT_UNMAPPED_ABSOLUTE:
+    converted_event->type = MANETTE_EVENT_UNMAPPED_ABSOLUTE_AXIS_CHANGED;
+    break;
+  case MANETTE_INPUT_EVENT_UNMAPPED_HAT:
+    converted_event->type = MANETTE_EVENT_UNMAPPED_HAT_AXIS_CHANGED;
+    converted_event->value = event->hat_value;
+    break;
+  case MANETTE_INPUT_EVENT_FRAME:
+    converted_event->type = MANETTE_EVENT_FRAME;
+    converted_event->index = 0;
+    break;
+  default:
+    g_assert_not_reached ();
+  }
+}
+
 static void
-button_event_cb (ManetteDevice *self,
-                 guint64        time,
-                 ManetteButton  button,
-                 gboolean       pressed)
+queue_event (ManetteDevice           *self,
+             const ManetteInputEvent *event)
 {
-  self->current_event_time = time;
+  ManetteEvent queued_event;
+
+  convert_event (self, event, &queued_event);
+  manette_event_queue_push (self->event_queue, &queued_event);
+}
+
+static void
+emit_event (ManetteDevice           *self,
+            const ManetteInputEvent *event)
+{
+  self->current_event_time = event->time;
+
+  if (self->event_queue)
+    queue_event (self, event);
+
+  if (self->has_sink)
+    sink_event (self, event);
+
+  switch (event->type) {
+  case MANETTE_INPUT_EVENT_BUTTON:
+    if (event->pressed)
+      g_signal_emit (self, signals[SIG_BUTTON_PRESSED], 0, event->index);
+    else
+      g_signal_emit (self, signals[SIG_BUTTON_RELEASED], 0, event->index);
+
+    break;
+  case MANETTE_INPUT_EVENT_AXIS:
+    g_signal_emit (self, signals[SIG_ABSOLUTE_AXIS_CHANGED], 0,
+                   event->index, event->value);
+
+    break;
+  case MANETTE_INPUT_EVENT_UNMAPPED_BUTTON:
+    if (event->pressed)
+      g_signal_emit (self, signals[SIG_UNMAPPED_BUTTON_PRESSED], 0, event->index);
+    else
+      g_signal_emit (self, signals[SIG_UNMAPPED_BUTTON_RELEASED], 0, event->index);
+
+    break;
+  case MANETTE_INPUT_EVENT_UNMAPPED_ABSOLUTE:
+    g_signal_emit (self, signals[SIG_UNMAPPED_ABSOLUTE_AXIS_CHANGED], 0,
+                   event->index, event->value);
+
+    break;
+  case MANETTE_INPUT_EVENT_UNMAPPED_HAT:
+    g_signal_emit (self, signals[SIG_UNMAPPED_HAT_AXIS_CHANGED], 0,
+                   event->index, event->hat_value);
+
+    break;
+  default:
+    g_assert_not_reached ();
+  }
+}
+
+static void
+deliver_frame (ManetteDevice           *self,
+               const ManetteInputEvent *frame_event)
+{
+  ManetteInputEvent events[MAX_FRAME_EVENTS];
+  const ManetteInputEvent *outer_events;
+  gsize n_outer_events;
+  gsize n_events, i;
+
+  g_object_ref (self);
+
+  /* Handlers may feed new events, e.g. by iterating the context, which
+   * delivers a nested frame.
+   */
+  n_events = self->n_frame_events;
+  memcpy (events, self->frame_events, n_events * sizeof (ManetteInputEvent));
+  self->n_frame_events = 0;
+
+  outer_events = self->delivered_events;
+  n_outer_events = self->n_delivered_events;
+  self->delivered_events = events;
+  self->n_delivered_events = n_events;
+
+  for (i = 0; i < n_events; i++)
+    update_state (self, &events[i]);
+
+  for (i = 0; i < n_events; i++)
+    emit_event (self, &events[i]);
+
+  self->current_event_time = frame_event->time;
+  self->state.time = frame_event->time;
+  if (self->event_queue)
+    queue_event (self, frame_event);
+  if (self->has_sink)
+    sink_event (self, frame_event);
+  g_signal_emit (self, signals[SIG_FRAME], 0);
 
-  if (pressed)
-    g_signal_emit (self, signals[SIG_BUTTON_PRESSED], 0, button);
-  else
-    g_signal_emit (self, signals[SIG_BUTTON_RELEASED], 0, button);
+  self->delivered_events = outer_events;
+  self->n_delivered_events = n_outer_events;
+
+  g_object_unref (self);
 }
 
 static void
-axis_event_cb (ManetteDevice *self,
-               guint64        time,
-               ManetteAxis    axis,
-               double         value)
+dispatch_event (const ManetteInputEvent *event,
+                ManetteDevice           *self)
 {
-  self->current_event_time = time;
+  if (event->type == MANETTE_INPUT_EVENT_FRAME) {
+    deliver_frame (self, event);
+
+    return;
+  }
+
+  /* Split the frame rather than dropping events */
+  if (self->n_frame_events == MAX_FRAME_EVENTS) {
+    ManetteInputEvent frame_event = {
+      .type = MANETTE_INPUT_EVENT_FRAME,
+      .time = self->frame_events[MAX_FRAME_EVENTS - 1].time,
+    };
+
+    deliver_frame (self, &frame_event);
+  }
 
-  g_signal_emit (self, signals[SIG_ABSOLUTE_AXIS_CHANGED], 0, axis, value);
+  self->frame_events[self->n_frame_events++] = *event;
 }
 
+/* Called directly by the backend, on the thread reading the events */
 static void
-unmapped_button_event_cb (ManetteDevice *self,
-                          guint64        time,
-                          guint          index,
-                          gboolean       pressed)
+handle_event (const ManetteInputEvent *event,
+              ManetteDevice           *self)
 {
-  self->current_event_time = time;
+  if (self->event_ring == NULL) {
+    dispatch_event (event, self);
 
-  if (pressed)
-    g_signal_emit (self, signals[SIG_UNMAPPED_BUTTON_PRESSED], 0, index);
-  else
-    g_signal_emit (self, signals[SIG_UNMAPPED_BUTTON_RELEASED], 0, index);
+    return;
+  }
+
+  if (!manette_event_ring_push (self->event_ring, event))
+    g_debug ("Dropped an event from %s, %u dropped so far",
+             manette_backend_get_name (self->backend),
+             manette_event_ring_get_n_dropped (self->event_ring));
 }
 
 static void
-unmapped_absolute_event_cb (ManetteDevice *self,
-                            guint64        time,
-                            guint          index,
-                            double         value)
+probe_capabilities (ManetteDevice *self)
 {
-  self->current_event_time = time;
+  Capabilities *capabilities = &self->capabilities;
+  guint i;
+
+  capabilities->vendor_id = manette_backend_get_vendor_id (self->backend);
+  capabilities->product_id = manette_backend_get_product_id (self->backend);
+  capabilities->bustype_id = manette_backend_get_bustype_id (self->backend);
+  capabilities->version_id = manette_backend_get_version_id (self->backend);
+  capabilities->has_rumble = manette_backend_has_rumble (self->backend);
+
+  for (i = 0; i <= MANETTE_BUTTON_TOUCHPAD; i++)
+    if (manette_backend_has_button (self->backend, i))
+      capabilities->unmapped_buttons |= G_GUINT64_CONSTANT (1) << i;
+
+  for (i = 0; i <= MANETTE_AXIS_RIGHT_TRIGGER; i++)
+    if (manette_backend_has_axis (self->backend, i))
+      capabilities->unmapped_axes |= 1 << i;
 
-  g_signal_emit (self, signals[SIG_UNMAPPED_ABSOLUTE_AXIS_CHANGED], 0, index, value);
+  capabilities->buttons = capabilities->unmapped_buttons;
+  capabilities->axes = capabilities->unmapped_axes;
 }
 
+/* A mapped device has the destinations of its mapping */
 static void
-unmapped_hat_event_cb (ManetteDevice *self,
-                       guint64        time,
-                       guint          index,
-                       gint8          value)
+update_mapped_capabilities (ManetteDevice  *self,
+                            ManetteMapping *mapping)
 {
-  self->current_event_time = time;
+  Capabilities *capabilities = &self->capabilities;
+  guint i;
+
+  if (mapping == NULL) {
+    capabilities->buttons = capabilities->unmapped_buttons;
+    capabilities->axes = capabilities->unmapped_axes;
+
+    return;
+  }
+
+  capabilities->buttons = 0;
+  capabilities->axes = 0;
 
-  g_signal_emit (self, signals[SIG_UNMAPPED_HAT_AXIS_CHANGED], 0, index, value);
+  for (i = 0; i <= MANETTE_BUTTON_TOUCHPAD; i++)
+    if (manette_mapping_has_destination_button (mapping, i))
+      capabilities->buttons |= G_GUINT64_CONSTANT (1) << i;
+
+  for (i = 0; i <= MANETTE_AXIS_RIGHT_TRIGGER; i++)
+    if (manette_mapping_has_destination_axis (mapping, i))
+      capabilities->axes |= 1 << i;
 }
 
 /**
@@ -305,28 +678,102 @@ manette_device_new (ManetteBackend  *backend,
                     GError         **error)
 {
   g_autoptr (ManetteDevice) self = NULL;
-  int vendor, product;
 
   g_return_val_if_fail (MANETTE_IS_BACKEND (backend), NULL);
 
   self = g_object_new (MANETTE_TYPE_DEVICE, NULL);
 
+  self->id = (guint) g_atomic_int_add (&last_id, 1) + 1;
   self->backend = backend;
 
-  vendor = manette_device_get_vendor_id (self);
-  product = manette_device_get_product_id (self);
+  probe_capabilities (self);
+
+  self->device_type = manette_device_type_guess (self->capabilities.vendor_id,
+                                                 self->capabilities.product_id);
 
-  self->device_type = manette_device_type_guess (vendor, product);
+  manette_backend_set_event_func (self->backend,
+                                  (ManetteBackendEventFunc) handle_event,
+                                  self);
 
-  g_signal_connect_swapped (self->backend, "button-event", G_CALLBACK (button_event_cb), self);
-  g_signal_connect_swapped (self->backend, "axis-event", G_CALLBACK (axis_event_cb), self);
-  g_signal_connect_swapped (self->backend, "unmapped-button-event", G_CALLBACK (unmapped_button_event_cb), self);
-  g_signal_connect_swapped (self->backend, "unmapped-absolute-event", G_CALLBACK (unmapped_absolute_event_cb), self);
-  g_signal_connect_swapped (self->backend, "unmapped-hat-event", G_CALLBACK (unmapped_hat_event_cb), self);
+  self->unmapped_events_enabled = TRUE;
 
   return g_steal_pointer (&self);
 }
 
+/**
+ * manette_device_start:
+ * @self: a device
+ * @input_thread: (nullable): the thread to read the events on
+ *
+ * Starts reading the events of @self.
+ *
+ * If @input_thread is %NULL, the events are read and emitted on the
+ * thread-default main context. Otherwise they are read and mapped on
+ * @input_thread, and then emitted on the thread-default main context.
+ */
+void
+manette_device_start (ManetteDevice      *self,
+                      ManetteInputThread *input_thread)
+{
+  GMainContext *context;
+
+  g_return_if_fail (MANETTE_IS_DEVICE (self));
+  g_return_if_fail (self->backend_source == NULL);
+
+  context = g_main_context_get_thread_default ();
+
+  if (input_thread) {
+    self->input_thread = manette_input_thread_ref (input_thread);
+
+    self->event_ring = manette_event_ring_new (EVENT_RING_CAPACITY);
+    g_source_set_callback (self->event_ring, (GSourceFunc) dispatch_event, self, NULL);
+    g_source_attach (self->event_ring, context);
+
+    context = manette_input_thread_get_context (input_thread);
+  }
+
+  self->backend_source = manette_backend_create_source (self->backend);
+  g_source_attach (self->backend_source, context);
+}
+
+/*
+ * manette_device_set_event_queue:
+ * @self: a device
+ * @queue: (nullable): the queue to copy the events to
+ *
+ * Copies the events of @self to @queue as they are emitted, for
+ * [method@Monitor.poll_events].
+ */
+void
+manette_device_set_event_queue (ManetteDevice     *self,
+                                ManetteEventQueue *queue)
+{
+  g_return_if_fail (MANETTE_IS_DEVICE (self));
+
+  g_clear_pointer (&self->event_queue, manette_event_queue_unref);
+  if (queue)
+    self->event_queue = manette_event_queue_ref (queue);
+}
+
+/**
+ * manette_device_get_id:
+ * @self: a device
+ *
+ * Gets the identifier of @self.
+ *
+ * It's unique among the devices of the process and never reused, unlike the
+ * filename of the device, and identifies @self in [struct@Event].
+ *
+ * Returns: the identifier of @self
+ */
+guint
+manette_device_get_id (ManetteDevice *self)
+{
+  g_return_val_if_fail (MANETTE_IS_DEVICE (self), 0);
+
+  return self->id;
+}
+
 /**
  * manette_device_get_guid:
  * @self: a device
@@ -362,7 +809,10 @@ manette_device_has_button (ManetteDevice *self,
 {
   g_return_val_if_fail (MANETTE_IS_DEVICE (self), FALSE);
 
-  return manette_backend_has_button (self->backend, button);
+  if ((guint) button > MANETTE_BUTTON_TOUCHPAD)
+    return FALSE;
+
+  return (self->capabilities.buttons >> button) & 1;
 }
 
 /**
@@ -380,7 +830,10 @@ manette_device_has_axis (ManetteDevice *self,
 {
   g_return_val_if_fail (MANETTE_IS_DEVICE (self), FALSE);
 
-  return manette_backend_has_axis (self->backend, axis);
+  if ((guint) axis > MANETTE_AXIS_RIGHT_TRIGGER)
+    return FALSE;
+
+  return (self->capabilities.axes >> axis) & 1;
 }
 
 /**
@@ -439,7 +892,7 @@ manette_device_get_product_id (ManetteDevice *self)
 {
   g_return_val_if_fail (MANETTE_IS_DEVICE (self), 0);
 
-  return manette_backend_get_product_id (self->backend);
+  return self->capabilities.product_id;
 }
 
 /**
@@ -459,7 +912,7 @@ manette_device_get_vendor_id (ManetteDevice *self)
 {
   g_return_val_if_fail (MANETTE_IS_DEVICE (self), 0);
 
-  return manette_backend_get_vendor_id (self->backend);
+  return self->capabilities.vendor_id;
 }
 
 /**
@@ -477,7 +930,7 @@ manette_device_get_bustype_id (ManetteDevice *self)
 {
   g_return_val_if_fail (MANETTE_IS_DEVICE (self), 0);
 
-  return manette_backend_get_bustype_id (self->backend);
+  return self->capabilities.bustype_id;
 }
 
 /**
@@ -493,7 +946,7 @@ manette_device_get_version_id (ManetteDevice *self)
 {
   g_return_val_if_fail (MANETTE_IS_DEVICE (self), 0);
 
-  return manette_backend_get_version_id (self->backend);
+  return self->capabilities.version_id;
 }
 
 /**
@@ -516,11 +969,15 @@ manette_device_get_device_type (ManetteDevice *self)
  * manette_device_get_current_event_time:
  * @self: a device
  *
- * Gets the timestamp of when the current event was emitted on @self.
+ * Gets the timestamp of when the current event was emitted on @self, in
+ * milliseconds.
  *
  * Use this timestamp to ensure external factors such as synchronous disk writes
  * don't influence your timing computations.
  *
+ * See [method@Device.get_current_event_time_usec] for a more precise
+ * timestamp.
+ *
  * Returns: the timestamp of when the current event was emitted
  */
 guint64
@@ -528,9 +985,239 @@ manette_device_get_current_event_time (ManetteDevice *self)
 {
   g_return_val_if_fail (MANETTE_IS_DEVICE (self), 0);
 
+  return self->current_event_time / 1000;
+}
+
+/**
+ * manette_device_get_current_event_time_usec:
+ * @self: a device
+ *
+ * Gets the timestamp of when the current event happened on @self, in
+ * microseconds.
+ *
+ * The timestamp is on the monotonic clock for all devices, like
+ * [func@GLib.get_monotonic_time], so it can be used to order the events of
+ * different devices or to measure the input latency.
+ *
+ * Returns: the timestamp of when the current event happened
+ */
+guint64
+manette_device_get_current_event_time_usec (ManetteDevice *self)
+{
+  g_return_val_if_fail (MANETTE_IS_DEVICE (self), 0);
+
   return self->current_event_time;
 }
 
+/**
+ * manette_device_get_button_state:
+ * @self: a device
+ * @button: a button
+ *
+ * Gets whether @button is currently pressed.
+ *
+ * This is meant for applications sampling the state of @self once per frame
+ * rather than listening to its signals.
+ *
+ * Returns: whether @button is pressed
+ */
+gboolean
+manette_device_get_button_state (ManetteDevice *self,
+                                 ManetteButton  button)
+{
+  g_return_val_if_fail (MANETTE_IS_DEVICE (self), FALSE);
+  g_return_val_if_fail (button <= MANETTE_BUTTON_TOUCHPAD, FALSE);
+
+  return (self->state.buttons & (G_GUINT64_CONSTANT (1) << button)) != 0;
+}
+
+/**
+ * manette_device_get_axis_value:
+ * @self: a device
+ * @axis: an axis
+ *
+ * Gets the current value of @axis.
+ *
+ * Sticks values range from -1 to 1, and triggers values range from 0 to 1.
+ *
+ * Returns: the value of @axis
+ */
+double
+manette_device_get_axis_value (ManetteDevice *self,
+                               ManetteAxis    axis)
+{
+  g_return_val_if_fail (MANETTE_IS_DEVICE (self), 0.0);
+  g_return_val_if_fail (axis < MANETTE_DEVICE_N_AXES, 0.0);
+
+  return self->state.axes[axis];
+}
+
+/**
+ * manette_device_get_state:
+ * @self: a device
+ * @state: (out caller-allocates): return location for the state
+ *
+ * Gets a snapshot of the current state of @self.
+ */
+void
+manette_device_get_state (ManetteDevice      *self,
+                          ManetteDeviceState *state)
+{
+  g_return_if_fail (MANETTE_IS_DEVICE (self));
+  g_return_if_fail (state != NULL);
+
+  *state = self->state;
+}
+
+/**
+ * manette_device_get_frame_events:
+ * @self: a device
+ * @events: (out caller-allocates) (array length=n_events): return location
+ *   for the events
+ * @n_events: the number of events @events can hold
+ *
+ * Gets the events of the frame being delivered, in the order they happened,
+ * without the event ending the frame.
+ *
+ * This is meant to be called from a [signal@Device::frame] handler, so that
+ * listening to that signal alone still gives every transition of the inputs
+ * of @self, including the ones [method@Device.get_state] can't tell, like a
+ * button pressed and released within the frame.
+ *
+ * Returns: the number of events of the frame, which can be more than
+ *   @n_events, or 0 if no frame is being delivered
+ */
+gsize
+manette_device_get_frame_events (ManetteDevice *self,
+                                 ManetteEvent  *events,
+                                 gsize          n_events)
+{
+  gsize i;
+
+  g_return_val_if_fail (MANETTE_IS_DEVICE (self), 0);
+  g_return_val_if_fail (events != NULL || n_events == 0, 0);
+
+  n_events = MIN (n_events, self->n_delivered_events);
+  for (i = 0; i < n_events; i++)
+    convert_event (self, &self->delivered_events[i], &events[i]);
+
+  return self->n_delivered_events;
+}
+
+/**
+ * manette_device_get_n_dropped_frames:
+ * @self: a device
+ *
+ * Gets how many times the system dropped events from @self because they
+ * weren't read fast enough.
+ *
+ * The state of @self is resynchronized after such drops, but intermediate
+ * changes are lost. Not all devices can report it, in which case it's always
+ * 0.
+ *
+ * Returns: the number of dropped frames
+ */
+guint
+manette_device_get_n_dropped_frames (ManetteDevice *self)
+{
+  g_return_val_if_fail (MANETTE_IS_DEVICE (self), 0);
+
+  return manette_backend_get_n_dropped_frames (self->backend);
+}
+
+/**
+ * manette_device_set_event_sink: (skip)
+ * @self: a device
+ * @sink: (nullable): the functions to pass the events to
+ * @user_data: the data to pass to the functions of @sink
+ * @destroy: (nullable): the function to free @user_data with
+ *
+ * Sets the functions the events of @self are passed to, replacing the previous
+ * ones.
+ *
+ * They are called directly on the same thread and in the same order as the
+ * signals of @self, but without boxing the arguments of each event, which
+ * matters for applications processing every event of several devices.
+ *
+ * @sink is copied, pass %NULL to unset it.
+ */
+void
+manette_device_set_event_sink (ManetteDevice                *self,
+                               const ManetteDeviceEventSink *sink,
+                               gpointer                      user_data,
+                               GDestroyNotify                destroy)
+{
+  GDestroyNotify old_destroy;
+  gpointer old_data;
+
+  g_return_if_fail (MANETTE_IS_DEVICE (self));
+
+  old_destroy = self->sink_destroy;
+  old_data = self->sink_data;
+
+  if (sink) {
+    self->sink = *sink;
+    self->sink_data = user_data;
+    self->sink_destroy = destroy;
+  } else {
+    memset (&self->sink, 0, sizeof (ManetteDeviceEventSink));
+    self->sink_data = NULL;
+    self->sink_destroy = NULL;
+  }
+
+  self->has_sink = sink != NULL;
+
+  if (old_destroy)
+    old_destroy (old_data);
+}
+
+/**
+ * manette_device_set_unmapped_events_enabled:
+ * @self: a device
+ * @enabled: whether to emit the unmapped button and absolute axis events
+ *
+ * Sets whether @self emits the unmapped button and absolute axis events, to
+ * its signals, its event sink and the monitor's event queue alike. They are
+ * enabled by default.
+ *
+ * Most devices report each input both unmapped and mapped, so applications
+ * not editing mappings can disable them to halve the events to process.
+ *
+ * The unmapped hat axis events are always emitted, as they update the state
+ * of @self.
+ */
+void
+manette_device_set_unmapped_events_enabled (ManetteDevice *self,
+                                            gboolean       enabled)
+{
+  g_return_if_fail (MANETTE_IS_DEVICE (self));
+
+  enabled = !!enabled;
+
+  if (enabled == self->unmapped_events_enabled)
+    return;
+
+  self->unmapped_events_enabled = enabled;
+  manette_backend_set_unmapped_events_enabled (self->backend, enabled);
+}
+
+/**
+ * manette_device_get_unmapped_events_enabled:
+ * @self: a device
+ *
+ * Gets whether @self emits the unmapped button and absolute axis events, see
+ * [method@Device.set_unmapped_events_enabled].
+ *
+ * Returns: whether the unmapped events are enabled
+ */
+gboolean
+manette_device_get_unmapped_events_enabled (ManetteDevice *self)
+{
+  g_return_val_if_fail (MANETTE_IS_DEVICE (self), FALSE);
+
+  return self->unmapped_events_enabled;
+}
+
 /**
  * manette_device_supports_mapping:
  * @self: a #ManetteDevice
@@ -547,6 +1234,39 @@ manette_device_supports_mapping (ManetteDevice *self)
   return self->device_type == MANETTE_DEVICE_GENERIC;
 }
 
+typedef struct {
+  ManetteBackend *backend;
+  ManetteMapping *mapping;
+} SetMappingData;
+
+static SetMappingData *
+set_mapping_data_new (ManetteBackend *backend,
+                      ManetteMapping *mapping)
+{
+  SetMappingData *data = g_new0 (SetMappingData, 1);
+
+  data->backend = g_object_ref (backend);
+  data->mapping = mapping ? g_object_ref (mapping) : NULL;
+
+  return data;
+}
+
+static void
+set_mapping_data_free (SetMappingData *data)
+{
+  g_clear_object (&data->backend);
+  g_clear_object (&data->mapping);
+  g_free (data);
+}
+
+static gboolean
+set_mapping_cb (SetMappingData *data)
+{
+  manette_backend_set_mapping (data->backend, data->mapping);
+
+  return G_SOURCE_REMOVE;
+}
+
 /**
  * manette_device_set_mapping:
  * @self: a device
@@ -562,7 +1282,20 @@ manette_device_set_mapping (ManetteDevice  *self,
   g_return_if_fail (MANETTE_IS_DEVICE (self));
   g_return_if_fail (manette_device_supports_mapping (self));
 
-  manette_backend_set_mapping (self->backend, mapping);
+  update_mapped_capabilities (self, mapping);
+
+  if (self->input_thread == NULL) {
+    manette_backend_set_mapping (self->backend, mapping);
+
+    return;
+  }
+
+  /* The backend maps the events on the input thread */
+  g_main_context_invoke_full (manette_input_thread_get_context (self->input_thread),
+                              G_PRIORITY_DEFAULT,
+                              (GSourceFunc) set_mapping_cb,
+                              set_mapping_data_new (self->backend, mapping),
+                              (GDestroyNotify) set_mapping_data_free);
 }
 
 /**
@@ -579,7 +1312,6 @@ char *
 manette_device_get_mapping (ManetteDevice *self)
 {
   const char *guid;
-  g_autoptr (ManetteMappingManager) mapping_manager = NULL;
 
   g_return_val_if_fail (MANETTE_IS_DEVICE (self), FALSE);
 
@@ -587,9 +1319,8 @@ manette_device_get_mapping (ManetteDevice *self)
     return NULL;
 
   guid = manette_device_get_guid (self);
-  mapping_manager = manette_mapping_manager_new ();
 
-  return manette_mapping_manager_get_mapping (mapping_manager, guid);
+  return manette_mapping_manager_get_mapping (get_mapping_manager (self), guid);
 }
 
 /**
@@ -604,7 +1335,6 @@ gboolean
 manette_device_has_user_mapping (ManetteDevice *self)
 {
   const char *guid;
-  g_autoptr (ManetteMappingManager) mapping_manager = NULL;
 
   g_return_val_if_fail (MANETTE_IS_DEVICE (self), FALSE);
 
@@ -612,9 +1342,8 @@ manette_device_has_user_mapping (ManetteDevice *self)
     return FALSE;
 
   guid = manette_device_get_guid (self);
-  mapping_manager = manette_mapping_manager_new ();
 
-  return manette_mapping_manager_has_user_mapping (mapping_manager, guid);
+  return manette_mapping_manager_has_user_mapping (get_mapping_manager (self), guid);
 }
 
 /**
@@ -630,7 +1359,6 @@ manette_device_save_user_mapping (ManetteDevice *self,
 {
   const char *guid;
   const char *name;
-  g_autoptr (ManetteMappingManager) mapping_manager = NULL;
 
   g_return_if_fail (MANETTE_IS_DEVICE (self));
   g_return_if_fail (mapping_string != NULL);
@@ -638,8 +1366,7 @@ manette_device_save_user_mapping (ManetteDevice *self,
 
   guid = manette_device_get_guid (self);
   name = manette_device_get_name (self);
-  mapping_manager = manette_mapping_manager_new ();
-  manette_mapping_manager_save_mapping (mapping_manager,
+  manette_mapping_manager_save_mapping (get_mapping_manager (self),
                                         guid,
                                         name,
                                         mapping_string);
@@ -655,14 +1382,12 @@ void
 manette_device_remove_user_mapping (ManetteDevice *self)
 {
   const char *guid;
-  g_autoptr (ManetteMappingManager) mapping_manager = NULL;
 
   g_return_if_fail (MANETTE_IS_DEVICE (self));
   g_return_if_fail (manette_device_supports_mapping (self));
 
   guid = manette_device_get_guid (self);
-  mapping_manager = manette_mapping_manager_new ();
-  manette_mapping_manager_delete_mapping (mapping_manager, guid);
+  manette_mapping_manager_delete_mapping (get_mapping_manager (self), guid);
 }
 
 /**
@@ -678,7 +1403,7 @@ manette_device_has_rumble (ManetteDevice *self)
 {
   g_return_val_if_fail (MANETTE_IS_DEVICE (self), FALSE);
 
-  return manette_backend_has_rumble (self->backend);
+  return self->capabilities.has_rumble;
 }
 
 /**
@@ -27,15 +27,103 @@
 #include <glib-object.h>
 
 #include "manette-device-type.h"
+#include "manette-event.h"
 #include "manette-inputs.h"
 
 G_BEGIN_DECLS
 
 #define MANETTE_TYPE_DEVICE (manette_device_get_type())
 
+/**
+ * MANETTE_DEVICE_N_AXES:
+ *
+ * The number of axes in [struct@DeviceState].
+ */
+#define MANETTE_DEVICE_N_AXES 6
+
+/**
+ * MANETTE_DEVICE_N_HATS:
+ *
+ * The number of hat axes in [struct@DeviceState].
+ */
+#define MANETTE_DEVICE_N_HATS 8
+
+/**
+ * ManetteDeviceState:
+ * @buttons: the pressed buttons, as a bitset indexed by [enum@Button]
+ * @axes: the values of the axes, indexed by [enum@Axis]
+ * @hats: the values of the unmapped hat axes, indexed by their hardware index
+ * @time: the timestamp of the last event, in microseconds on the monotonic
+ *   clock like [func@GLib.get_monotonic_time]
+ *
+ * A snapshot of the state of a device.
+ *
+ * The sticks values range from -1 to 1, and the triggers values range from 0
+ * to 1. The hat axes values are -1, 0 or 1.
+ */
+typedef struct {
+  guint64 buttons;
+  double axes[MANETTE_DEVICE_N_AXES];
+  gint8 hats[MANETTE_DEVICE_N_HATS];
+  guint64 time;
+} ManetteDeviceState;
+
 MANETTE_AVAILABLE_IN_ALL
 G_DECLARE_FINAL_TYPE (ManetteDevice, manette_device, MANETTE, DEVICE, GObject)
 
+/**
+ * ManetteDeviceEventSink: (skip)
+ * @button_event: called when a button is pressed or released
+ * @absolute_axis_event: called when the value of an axis changes
+ * @unmapped_button_event: called when an unmapped button is pressed or
+ *   released
+ * @unmapped_absolute_axis_event: called when the value of an unmapped
+ *   absolute axis changes
+ * @unmapped_hat_axis_event: called when the value of an unmapped hat axis
+ *   changes
+ * @frame: called at the end of each hardware frame
+ *
+ * Functions receiving the events of a device, see
+ * [method@Device.set_event_sink].
+ *
+ * They match the signals of [class@Device], and are called right before them,
+ * with the time of the event in microseconds like
+ * [method@Device.get_current_event_time_usec]. Any of them can be %NULL.
+ */
+typedef struct {
+  void (* button_event)                 (ManetteDevice *device,
+                                         guint64        time,
+                                         ManetteButton  button,
+                                         gboolean       pressed,
+                                         gpointer       user_data);
+  void (* absolute_axis_event)          (ManetteDevice *device,
+                                         guint64        time,
+                                         ManetteAxis    axis,
+                                         double         value,
+                                         gpointer       user_data);
+  void (* unmapped_button_event)        (ManetteDevice *device,
+                                         guint64        time,
+                                         guint          index,
+                                         gboolean       pressed,
+                                         gpointer       user_data);
+  void (* unmapped_absolute_axis_event) (ManetteDevice *device,
+                                         guint64        time,
+                                         guint          index,
+                                         double         value,
+                                         gpointer       user_data);
+  void (* unmapped_hat_axis_event)      (ManetteDevice *device,
+                                         guint64        time,
+                                         guint          index,
+                                         gint8          value,
+                                         gpointer       user_data);
+  void (* frame)                        (ManetteDevice *device,
+                                         guint64        time,
+                                         gpointer       user_data);
+
+  /*< private >*/
+  gpointer padding[8];
+} ManetteDeviceEventSink;
+
 MANETTE_AVAILABLE_IN_ALL
 gboolean manette_device_has_button (ManetteDevice *self,
                                     ManetteButton  button);
@@ -49,6 +137,9 @@ gboolean manette_device_has_input (ManetteDevice *self,
                                    guint          type,
                                    guint          code);
 
+MANETTE_AVAILABLE_IN_ALL
+guint manette_device_get_id (ManetteDevice *self);
+
 MANETTE_AVAILABLE_IN_ALL
 const char *manette_device_get_name (ManetteDevice *self);
 
@@ -61,6 +152,42 @@ ManetteDeviceType manette_device_get_device_type (ManetteDevice *self);
 MANETTE_AVAILABLE_IN_ALL
 guint64 manette_device_get_current_event_time (ManetteDevice *self);
 
+MANETTE_AVAILABLE_IN_ALL
+guint64 manette_device_get_current_event_time_usec (ManetteDevice *self);
+
+MANETTE_AVAILABLE_IN_ALL
+gboolean manette_device_get_button_state (ManetteDevice *self,
+                                          ManetteButton  button);
+
+MANETTE_AVAILABLE_IN_ALL
+double manette_device_get_axis_value (ManetteDevice *self,
+                                      ManetteAxis    axis);
+
+MANETTE_AVAILABLE_IN_ALL
+void manette_device_get_state (ManetteDevice      *self,
+                               ManetteDeviceState *state);
+
+MANETTE_AVAILABLE_IN_ALL
+gsize manette_device_get_frame_events (ManetteDevice *self,
+                                       ManetteEvent  *events,
+                                       gsize          n_events);
+
+MANETTE_AVAILABLE_IN_ALL
+guint manette_device_get_n_dropped_frames (ManetteDevice *self);
+
+MANETTE_AVAILABLE_IN_ALL
+void manette_device_set_event_sink (ManetteDevice                *self,
+                                    const ManetteDeviceEventSink *sink,
+                                    gpointer                      user_data,
+                                    GDestroyNotify                destroy);
+
+MANETTE_AVAILABLE_IN_ALL
+void manette_device_set_unmapped_events_enabled (ManetteDevice *self,
+                                                 gboolean       enabled);
+
+MANETTE_AVAILABLE_IN_ALL
+gboolean manette_device_get_unmapped_events_enabled (ManetteDevice *self);
+
 MANETTE_AVAILABLE_IN_ALL
 gboolean manette_device_supports_mapping (ManetteDevice *self);
 
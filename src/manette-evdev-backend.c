@@ -21,11 +21,13 @@
 
 #include "manette-evdev-backend-private.h"
 
+#include <errno.h>
 #include <fcntl.h>
 #include <libevdev/libevdev.h>
 #include <linux/input.h>
 #include <linux/input-event-codes.h>
 #include <sys/ioctl.h>
+#include <time.h>
 #include <unistd.h>
 
 #include "manette-device-type-private.h"
@@ -41,16 +43,24 @@ struct _ManetteEvdevBackend
   char *filename;
 
   int fd;
-  guint event_source_id;
   struct libevdev *evdev_device;
+  gboolean monotonic_clock;
+  guint n_dropped_frames;
 
   guint8 key_map[KEY_MAX];
   guint8 abs_map[ABS_MAX];
   struct input_absinfo abs_info[ABS_MAX];
 
   struct ff_effect rumble_effect;
+  gboolean has_rumble;
 
   ManetteMapping *mapping;
+  ManetteMappingState mapping_state;
+  /* Sized for the input of the mapping with the most bindings */
+  ManetteMappedEvent *mapped_events;
+  gsize n_mapped_events;
+
+  ManetteBackendEventSink event_sink;
 };
 
 static void manette_evdev_backend_backend_init (ManetteBackendInterface *iface);
@@ -140,32 +150,29 @@ centered_absolute_value (struct input_absinfo *abs_info,
 static void
 emit_mapped_events (ManetteEvdevBackend *self,
                     guint64              time,
-                    GSList              *mapped_events)
+                    ManetteMappedEvent  *mapped_events,
+                    gsize                n_mapped_events)
 {
-  GSList *l = NULL;
-
-  for (l = mapped_events; l != NULL; l = l->next) {
-    ManetteMappedEvent *mapped_event = l->data;
+  for (gsize i = 0; i < n_mapped_events; i++) {
+    ManetteMappedEvent *mapped_event = &mapped_events[i];
 
     switch (mapped_event->type) {
     case MANETTE_MAPPING_DESTINATION_TYPE_AXIS:
-      manette_backend_emit_axis_event (MANETTE_BACKEND (self), time,
-                                       mapped_event->axis.axis,
-                                       mapped_event->axis.value);
+      manette_backend_event_sink_emit_axis (&self->event_sink, time,
+                                            mapped_event->axis.axis,
+                                            mapped_event->axis.value);
       break;
 
     case MANETTE_MAPPING_DESTINATION_TYPE_BUTTON:
-      manette_backend_emit_button_event (MANETTE_BACKEND (self), time,
-                                         mapped_event->button.button,
-                                         mapped_event->button.pressed);
+      manette_backend_event_sink_emit_button (&self->event_sink, time,
+                                              mapped_event->button.button,
+                                              mapped_event->button.pressed);
       break;
 
     default:
       g_assert_not_reached ();
     }
   }
-
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
 }
 
 static ManetteButton
@@ -292,8 +299,13 @@ static void
 on_evdev_event (ManetteEvdevBackend *self,
                 struct input_event  *evdev_event)
 {
-  guint64 time = evdev_event->input_event_sec * 1000 +
-                 evdev_event->input_event_usec / 1000;
+  guint64 time;
+
+  if (G_LIKELY (self->monotonic_clock))
+    time = evdev_event->input_event_sec * G_USEC_PER_SEC +
+           evdev_event->input_event_usec;
+  else
+    time = g_get_monotonic_time ();
 
   switch (evdev_event->type) {
   case EV_KEY:
@@ -302,22 +314,26 @@ on_evdev_event (ManetteEvdevBackend *self,
       evdev_event->code + BTN_MISC :
       evdev_event->code - BTN_MISC;
 
-    manette_backend_emit_unmapped_button_event (MANETTE_BACKEND (self), time,
-                                                self->key_map[index], pressed);
+    manette_backend_event_sink_emit_unmapped_button (&self->event_sink, time,
+                                                     self->key_map[index], pressed);
 
     if (self->mapping == NULL) {
       ManetteButton button = evdev_code_to_button (evdev_event->code);
 
       if (button != -1) {
-        manette_backend_emit_button_event (MANETTE_BACKEND (self),
-                                           time, button, pressed);
+        manette_backend_event_sink_emit_button (&self->event_sink,
+                                                time, button, pressed);
       }
     } else {
-      GSList *mapped = manette_map_button_event (self->mapping,
-                                                 self->key_map[index],
-                                                 pressed);
+      gsize n_mapped;
+
+      n_mapped = manette_map_button_event (self->mapping,
+                                           &self->mapping_state,
+                                           self->key_map[index], pressed,
+                                           self->mapped_events,
+                                           self->n_mapped_events);
 
-      emit_mapped_events (self, time, mapped);
+      emit_mapped_events (self, time, self->mapped_events, n_mapped);
     }
 
     break;
@@ -335,29 +351,45 @@ on_evdev_event (ManetteEvdevBackend *self,
         self->key_map[(evdev_event->code - ABS_HAT0X) / 2] * 2 +
         (evdev_event->code - ABS_HAT0X) % 2;
 
-      manette_backend_emit_unmapped_hat_event (MANETTE_BACKEND (self), time,
-                                               index, evdev_event->value);
+      manette_backend_event_sink_emit_unmapped_hat (&self->event_sink, time,
+                                                    index, evdev_event->value);
 
       // We don't send unmapped hat events
       if (self->mapping != NULL) {
-        GSList *mapped = manette_map_hat_event (self->mapping, index,
-                                                evdev_event->value);
+        gsize n_mapped;
 
-        emit_mapped_events (self, time, mapped);
+        n_mapped = manette_map_hat_event (self->mapping,
+                                          &self->mapping_state, index,
+                                          evdev_event->value,
+                                          self->mapped_events,
+                                          self->n_mapped_events);
+
+        emit_mapped_events (self, time, self->mapped_events, n_mapped);
       }
 
       break;
     default:
-      double value =
-        centered_absolute_value (&self->abs_info[self->abs_map[evdev_event->code]],
-                                 evdev_event->value);
-
-      manette_backend_emit_unmapped_absolute_event (MANETTE_BACKEND (self), time,
-                                                    evdev_event->code, value);
+      gboolean unmapped_wanted =
+        manette_backend_event_sink_wants_unmapped_events (&self->event_sink);
+      ManetteAxis axis = -1;
+      double value;
 
       if (self->mapping == NULL) {
-        ManetteAxis axis = evdev_code_to_axis (evdev_event->code);
+        axis = evdev_code_to_axis (evdev_event->code);
+
+        /* Don't compute a value nothing will get */
+        if (axis == -1 && !unmapped_wanted)
+          break;
+      }
 
+      value = centered_absolute_value (&self->abs_info[self->abs_map[evdev_event->code]],
+                                       evdev_event->value);
+
+      if (unmapped_wanted)
+        manette_backend_event_sink_emit_unmapped_absolute (&self->event_sink, time,
+                                                           evdev_event->code, value);
+
+      if (self->mapping == NULL) {
         if (axis == -1)
           break;
 
@@ -366,18 +398,28 @@ on_evdev_event (ManetteEvdevBackend *self,
           value = (value + 1.0) / 2.0;
         }
 
-        manette_backend_emit_axis_event (MANETTE_BACKEND (self),
-                                         time, axis, value);
+        manette_backend_event_sink_emit_axis (&self->event_sink,
+                                              time, axis, value);
       } else {
-        GSList *mapped = manette_map_absolute_event (self->mapping,
-                                                     evdev_event->code, value);
+        gsize n_mapped;
 
-        emit_mapped_events (self, time, mapped);
+        n_mapped = manette_map_absolute_event (self->mapping,
+                                               &self->mapping_state,
+                                               evdev_event->code, value,
+                                               self->mapped_events,
+                                               self->n_mapped_events);
+
+        emit_mapped_events (self, time, self->mapped_events, n_mapped);
       }
 
       break;
     }
 
+    break;
+  case EV_SYN:
+    if (evdev_event->code == SYN_REPORT)
+      manette_backend_event_sink_emit_frame (&self->event_sink, time);
+
     break;
   default:
     return;
@@ -390,15 +432,39 @@ poll_events (GIOChannel          *source,
              ManetteEvdevBackend *self)
 {
   struct input_event evdev_event;
+  int status;
 
   g_assert (MANETTE_IS_EVDEV_BACKEND (self));
 
-  while (libevdev_has_event_pending (self->evdev_device)) {
-    if (libevdev_next_event (self->evdev_device,
-                             (guint) LIBEVDEV_READ_FLAG_NORMAL,
-                             &evdev_event) == 0) {
-      on_evdev_event (self, &evdev_event);
+  while (TRUE) {
+    status = libevdev_next_event (self->evdev_device,
+                                  (guint) LIBEVDEV_READ_FLAG_NORMAL,
+                                  &evdev_event);
+
+    if (status == LIBEVDEV_READ_STATUS_SYNC) {
+      /* The kernel buffer overflowed and dropped events. libevdev gives the
+       * difference between the state we know and the actual one, ending with
+       * a SYN_REPORT, so no input is left stuck.
+       */
+      g_atomic_int_inc (&self->n_dropped_frames);
+      g_debug ("%s dropped events, resynchronizing", self->filename);
+
+      while (status == LIBEVDEV_READ_STATUS_SYNC) {
+        on_evdev_event (self, &evdev_event);
+        status = libevdev_next_event (self->evdev_device,
+                                      (guint) LIBEVDEV_READ_FLAG_SYNC,
+                                      &evdev_event);
+      }
+
+      /* -EAGAIN means the sync is done, go on with the normal events */
+      if (status == -EAGAIN)
+        continue;
     }
+
+    if (status != LIBEVDEV_READ_STATUS_SUCCESS)
+      break;
+
+    on_evdev_event (self, &evdev_event);
   }
 
   return TRUE;
@@ -410,7 +476,7 @@ manette_evdev_backend_finalize (GObject *object)
   ManetteEvdevBackend *self = MANETTE_EVDEV_BACKEND (object);
 
   g_clear_object (&self->mapping);
-  g_clear_handle_id (&self->event_source_id, g_source_remove);
+  g_clear_pointer (&self->mapped_events, g_free);
   close (self->fd);
   libevdev_free (self->evdev_device);
   g_free (self->filename);
@@ -433,11 +499,24 @@ manette_evdev_backend_init (ManetteEvdevBackend *self)
   self->rumble_effect.id = -1;
 }
 
+static gboolean
+probe_rumble (ManetteEvdevBackend *self)
+{
+  gulong features[4];
+
+  if (ioctl (self->fd, EVIOCGBIT (EV_FF, sizeof (gulong) * 4), features) == -1)
+    return FALSE;
+
+  if (!((features[FF_RUMBLE / (sizeof (glong) * 8)] >> FF_RUMBLE % (sizeof (glong) * 8)) & 1))
+    return FALSE;
+
+  return TRUE;
+}
+
 static gboolean
 manette_evdev_backend_initialize (ManetteBackend *backend)
 {
   ManetteEvdevBackend *self = MANETTE_EVDEV_BACKEND (backend);
-  g_autoptr (GIOChannel) channel = NULL;
   int vendor, product;
   int buttons_number;
   int axes_number;
@@ -464,9 +543,12 @@ manette_evdev_backend_initialize (ManetteBackend *backend)
   if (manette_device_type_guess (vendor, product) != MANETTE_DEVICE_GENERIC)
     return FALSE;
 
-  // Poll the events in the main loop.
-  channel = g_io_channel_unix_new (self->fd);
-  self->event_source_id = g_io_add_watch (channel, G_IO_IN, (GIOFunc) poll_events, self);
+  /* Have the kernel stamp the events on the same clock as the HID reports,
+   * instead of the wall clock, with EVIOCSCLOCKID.
+   */
+  self->monotonic_clock = libevdev_set_clock_id (self->evdev_device, CLOCK_MONOTONIC) == 0;
+  if (!self->monotonic_clock)
+    g_debug ("Failed to set the clock of %s, stamping events on read", self->filename);
 
   buttons_number = 0;
 
@@ -508,9 +590,25 @@ manette_evdev_backend_initialize (ManetteBackend *backend)
     }
   }
 
+  self->has_rumble = probe_rumble (self);
+
   return TRUE;
 }
 
+static GSource *
+manette_evdev_backend_create_source (ManetteBackend *backend)
+{
+  ManetteEvdevBackend *self = MANETTE_EVDEV_BACKEND (backend);
+  g_autoptr (GIOChannel) channel = NULL;
+  GSource *source;
+
+  channel = g_io_channel_unix_new (self->fd);
+  source = g_io_create_watch (channel, G_IO_IN);
+  g_source_set_callback (source, (GSourceFunc) poll_events, self, NULL);
+
+  return source;
+}
+
 static const char *
 manette_evdev_backend_get_name (ManetteBackend *backend)
 {
@@ -557,7 +655,36 @@ manette_evdev_backend_set_mapping (ManetteBackend *backend,
 {
   ManetteEvdevBackend *self = MANETTE_EVDEV_BACKEND (backend);
 
+  /* Keep the state if the mapping didn't change */
+  if (self->mapping == mapping)
+    return;
+
+  /* Release what the previous mapping held, as its bindings may not exist
+   * anymore to release it later.
+   */
+  if (self->mapping != NULL) {
+    guint64 pressed_buttons;
+
+    pressed_buttons = manette_mapping_state_get_pressed_buttons (&self->mapping_state,
+                                                                 self->mapping);
+    if (pressed_buttons != 0) {
+      guint64 time = g_get_monotonic_time ();
+      ManetteButton button;
+
+      for (button = 0; button <= MANETTE_BUTTON_TOUCHPAD; button++)
+        if (pressed_buttons & (G_GUINT64_CONSTANT (1) << button))
+          manette_backend_event_sink_emit_button (&self->event_sink, time, button, FALSE);
+
+      manette_backend_event_sink_emit_frame (&self->event_sink, time);
+    }
+  }
+
   g_set_object (&self->mapping, mapping);
+  self->mapping_state = (ManetteMappingState) {};
+
+  self->n_mapped_events = mapping ? manette_mapping_get_max_bindings_per_input (mapping) : 0;
+  self->mapped_events = g_renew (ManetteMappedEvent, self->mapped_events,
+                                 self->n_mapped_events);
 }
 
 gboolean
@@ -608,15 +735,8 @@ static gboolean
 manette_evdev_backend_has_rumble (ManetteBackend *backend)
 {
   ManetteEvdevBackend *self = MANETTE_EVDEV_BACKEND (backend);
-  gulong features[4];
 
-  if (ioctl (self->fd, EVIOCGBIT (EV_FF, sizeof (gulong) * 4), features) == -1)
-    return FALSE;
-
-  if (!((features[FF_RUMBLE / (sizeof (glong) * 8)] >> FF_RUMBLE % (sizeof (glong) * 8)) & 1))
-    return FALSE;
-
-  return TRUE;
+  return self->has_rumble;
 }
 
 static gboolean
@@ -652,10 +772,27 @@ manette_evdev_backend_rumble (ManetteBackend *backend,
   return TRUE;
 }
 
+static guint
+manette_evdev_backend_get_n_dropped_frames (ManetteBackend *backend)
+{
+  ManetteEvdevBackend *self = MANETTE_EVDEV_BACKEND (backend);
+
+  return g_atomic_int_get (&self->n_dropped_frames);
+}
+
+static ManetteBackendEventSink *
+manette_evdev_backend_get_event_sink (ManetteBackend *backend)
+{
+  ManetteEvdevBackend *self = MANETTE_EVDEV_BACKEND (backend);
+
+  return &self->event_sink;
+}
+
 static void
 manette_evdev_backend_backend_init (ManetteBackendInterface *iface)
 {
   iface->initialize = manette_evdev_backend_initialize;
+  iface->create_source = manette_evdev_backend_create_source;
   iface->get_name = manette_evdev_backend_get_name;
   iface->get_vendor_id = manette_evdev_backend_get_vendor_id;
   iface->get_product_id = manette_evdev_backend_get_product_id;
@@ -667,6 +804,8 @@ manette_evdev_backend_backend_init (ManetteBackendInterface *iface)
   iface->has_input = manette_evdev_backend_has_input;
   iface->has_rumble = manette_evdev_backend_has_rumble;
   iface->rumble = manette_evdev_backend_rumble;
+  iface->get_n_dropped_frames = manette_evdev_backend_get_n_dropped_frames;
+  iface->get_event_sink = manette_evdev_backend_get_event_sink;
 }
 
 ManetteBackend *
@@ -28,6 +28,12 @@
 
 G_BEGIN_DECLS
 
+/* Enough for any input of the bundled mappings, which bind at most two
+ * destinations to the same input. User mappings can bind more, size the
+ * buffer with manette_mapping_get_max_bindings_per_input() for those.
+ */
+#define MANETTE_MAX_MAPPED_EVENTS 16
+
 typedef union {
   ManetteMappingDestinationType type;
   struct {
@@ -42,16 +48,49 @@ typedef union {
   } axis;
 } ManetteMappedEvent;
 
-GSList *manette_map_button_event (ManetteMapping *mapping,
-                                  guint           index,
-                                  gboolean        pressed);
+/* The bindings whose state is tracked, which is more than any sensible
+ * mapping has. The button events of the bindings past it are always reported.
+ */
+#define MANETTE_MAPPING_STATE_N_BINDINGS 256
+
+/* Whether the button destination of each binding of a mapping is pressed, so
+ * that only transitions are reported. Each binding is tracked on its own so
+ * that sources bound to the same button don't filter each other's
+ * transitions. Zero-initialize it to have every button released.
+ */
+typedef struct {
+  guint64 pressed_bindings[MANETTE_MAPPING_STATE_N_BINDINGS / 64];
+} ManetteMappingState;
+
+G_STATIC_ASSERT (MANETTE_BUTTON_TOUCHPAD < 64);
+
+guint64 manette_mapping_state_get_pressed_buttons (const ManetteMappingState *state,
+                                                   ManetteMapping            *mapping);
+
+/* These write the events an input maps to into @mapped_events and return how
+ * many were written, which is at most @n_mapped_events. The events that don't
+ * fit are dropped, which is reported once. If @state isn't %NULL, button
+ * events that don't change it are skipped.
+ */
+gsize manette_map_button_event (ManetteMapping      *mapping,
+                                ManetteMappingState *state,
+                                guint                index,
+                                gboolean             pressed,
+                                ManetteMappedEvent  *mapped_events,
+                                gsize                n_mapped_events);
 
-GSList *manette_map_absolute_event (ManetteMapping *mapping,
-                                    guint           index,
-                                    double          value);
+gsize manette_map_absolute_event (ManetteMapping      *mapping,
+                                  ManetteMappingState *state,
+                                  guint                index,
+                                  double               value,
+                                  ManetteMappedEvent  *mapped_events,
+                                  gsize                n_mapped_events);
 
-GSList *manette_map_hat_event (ManetteMapping *mapping,
-                               guint           index,
-                               gint8           value);
+gsize manette_map_hat_event (ManetteMapping      *mapping,
+                             ManetteMappingState *state,
+                             guint                index,
+                             gint8                value,
+                             ManetteMappedEvent  *mapped_events,
+                             gsize                n_mapped_events);
 
 G_END_DECLS
@@ -20,195 +20,182 @@
 
 #include "manette-event-mapping-private.h"
 
-GSList *
-manette_map_button_event (ManetteMapping *mapping,
-                          guint           index,
-                          gboolean        pressed)
+static inline gboolean
+dispatch_value (const ManetteMappingDispatchEntry *entry,
+                ManetteMappingState               *state,
+                double                             value,
+                ManetteMappedEvent                *mapped_event)
 {
-  const ManetteMappingBinding * const *bindings;
-  const ManetteMappingBinding * binding;
-  GSList *mapped_events = NULL;
-
-  bindings = manette_mapping_get_bindings (mapping,
-                                           MANETTE_MAPPING_INPUT_TYPE_BUTTON,
-                                           index);
-  if (bindings == NULL)
-    return NULL;
-
-  for (; *bindings != NULL; bindings++) {
-    ManetteMappedEvent *mapped_event = g_new0 (ManetteMappedEvent, 1);
-
-    binding = *bindings;
-
-    mapped_event->type = binding->destination.type;
-
-    switch (binding->destination.type) {
-    case MANETTE_MAPPING_DESTINATION_TYPE_AXIS:
-      mapped_event->axis.axis = binding->destination.code;
-
-      switch (binding->destination.range) {
-      case MANETTE_MAPPING_RANGE_NEGATIVE:
-        mapped_event->axis.value = pressed ? -1 : 0;
-        break;
-      case MANETTE_MAPPING_RANGE_FULL:
-      case MANETTE_MAPPING_RANGE_POSITIVE:
-        mapped_event->axis.value = pressed ? 1 : 0;
-        break;
-      default:
-        mapped_event->axis.value = 0;
-        break;
-      }
-
-      break;
-    case MANETTE_MAPPING_DESTINATION_TYPE_BUTTON:
-      mapped_event->button.button = binding->destination.code;
-      mapped_event->button.pressed = pressed;
-
-      break;
-    default:
-      continue;
+  value = value * entry->scale + entry->offset;
+
+  mapped_event->type = entry->type;
+
+  if (entry->type == MANETTE_MAPPING_DESTINATION_TYPE_AXIS) {
+    mapped_event->axis.axis = entry->code;
+    mapped_event->axis.value = value;
+  } else {
+    gboolean pressed = value > entry->threshold;
+
+    if (state != NULL && entry->position < MANETTE_MAPPING_STATE_N_BINDINGS) {
+      guint64 *word = &state->pressed_bindings[entry->position / 64];
+      guint64 mask = G_GUINT64_CONSTANT (1) << (entry->position % 64);
+
+      if (!!(*word & mask) == pressed)
+        return FALSE;
+
+      *word ^= mask;
     }
 
-    mapped_events = g_slist_append (mapped_events, mapped_event);
+    mapped_event->button.button = entry->code;
+    mapped_event->button.pressed = pressed;
   }
 
-  return mapped_events;
+  return TRUE;
 }
 
-GSList *
-manette_map_absolute_event (ManetteMapping *mapping,
-                            guint           index,
-                            double          value)
+/**
+ * manette_mapping_state_get_pressed_buttons:
+ * @state: the state of the bindings of @mapping
+ * @mapping: a mapping
+ *
+ * Gets the buttons held by the bindings of @mapping, for example to release
+ * them before switching to another mapping.
+ *
+ * Returns: a mask of the pressed buttons, indexed by [enum@Button]
+ */
+guint64
+manette_mapping_state_get_pressed_buttons (const ManetteMappingState *state,
+                                           ManetteMapping            *mapping)
 {
-  const ManetteMappingBinding * const *bindings;
-  const ManetteMappingBinding * binding;
-  GSList *mapped_events = NULL;
-  gboolean pressed;
-
-  bindings = manette_mapping_get_bindings (mapping,
-                                           MANETTE_MAPPING_INPUT_TYPE_AXIS,
-                                           index);
-  if (bindings == NULL)
-    return NULL;
-
-  for (; *bindings != NULL; bindings++) {
-    ManetteMappedEvent *mapped_event;
-    double absolute_value = value;
-
-    binding = *bindings;
-
-    if (binding->source.range == MANETTE_MAPPING_RANGE_NEGATIVE && absolute_value > 0.)
-      absolute_value = 0;
-
-    if (binding->source.range == MANETTE_MAPPING_RANGE_POSITIVE && absolute_value < 0.)
-      absolute_value = 0;
-
-    mapped_event = g_new0 (ManetteMappedEvent, 1);
-    mapped_event->type = binding->destination.type;
-
-    switch (binding->destination.type) {
-    case MANETTE_MAPPING_DESTINATION_TYPE_AXIS:
-      absolute_value = binding->source.invert ? -absolute_value : absolute_value;
-
-      mapped_event->axis.axis = binding->destination.code;
-      switch (binding->destination.range) {
-      case MANETTE_MAPPING_RANGE_FULL:
-        mapped_event->axis.value = absolute_value;
-        break;
-      case MANETTE_MAPPING_RANGE_NEGATIVE:
-        mapped_event->axis.value = (absolute_value - 1) / 2;
-        break;
-      case MANETTE_MAPPING_RANGE_POSITIVE:
-        mapped_event->axis.value = (absolute_value + 1) / 2;
-        break;
-      default:
-        break;
-      }
-
-      break;
-    case MANETTE_MAPPING_DESTINATION_TYPE_BUTTON:
-      if (binding->source.range == MANETTE_MAPPING_RANGE_FULL) {
-        pressed = binding->source.invert ? absolute_value < 0. :
-                                           absolute_value > 0.;
-      } else {
-        pressed = binding->source.invert ? ABS (absolute_value) < 0.5 :
-                                           ABS (absolute_value) > 0.5;
-      }
-
-      mapped_event->button.button = binding->destination.code;
-      mapped_event->button.pressed = pressed;
-
-      break;
-    default:
-      continue;
-    }
+  const ManetteMappingDispatchEntry *entries;
+  gsize n_entries;
+  guint64 pressed_buttons = 0;
+  gsize i;
 
-    mapped_events = g_slist_append (mapped_events, mapped_event);
-  }
+  entries = manette_mapping_get_dispatch_entries (mapping, &n_entries);
+  n_entries = MIN (n_entries, MANETTE_MAPPING_STATE_N_BINDINGS);
 
-  return mapped_events;
+  for (i = 0; i < n_entries; i++)
+    if (state->pressed_bindings[i / 64] & (G_GUINT64_CONSTANT (1) << (i % 64)))
+      pressed_buttons |= G_GUINT64_CONSTANT (1) << entries[i].code;
+
+  return pressed_buttons;
 }
 
-GSList *
-manette_map_hat_event (ManetteMapping *mapping,
-                       guint           index,
-                       gint8           value)
+static void
+report_truncation (gsize n_entries,
+                   gsize n_mapped_events)
 {
-  const ManetteMappingBinding * const *bindings;
-  const ManetteMappingBinding * binding;
-  GSList *mapped_events = NULL;
+  static int reported;
 
-  bindings = manette_mapping_get_bindings (mapping,
-                                           MANETTE_MAPPING_INPUT_TYPE_HAT,
-                                           index);
-  if (bindings == NULL)
-    return NULL;
+  if (g_atomic_int_compare_and_exchange (&reported, FALSE, TRUE))
+    g_debug ("An input is bound %" G_GSIZE_FORMAT " times, but there's only room "
+             "for %" G_GSIZE_FORMAT " mapped events: dropping the others",
+             n_entries, n_mapped_events);
+}
 
-  for (; *bindings != NULL; bindings++) {
-    ManetteMappedEvent *mapped_event = g_new0 (ManetteMappedEvent, 1);
-    gboolean pressed;
+gsize
+manette_map_button_event (ManetteMapping      *mapping,
+                          ManetteMappingState *state,
+                          guint                index,
+                          gboolean             pressed,
+                          ManetteMappedEvent  *mapped_events,
+                          gsize                n_mapped_events)
+{
+  const ManetteMappingDispatchEntry *entries;
+  gsize n_entries;
+  gsize n = 0;
+  gsize i;
 
-    binding = *bindings;
+  entries = manette_mapping_get_dispatch (mapping,
+                                          MANETTE_MAPPING_INPUT_TYPE_BUTTON,
+                                          index, &n_entries);
 
-    mapped_event->type = binding->destination.type;
+  for (i = 0; i < n_entries && n < n_mapped_events; i++)
+    if (dispatch_value (&entries[i], state, pressed ? 1 : 0, &mapped_events[n]))
+      n++;
 
-    switch (binding->destination.type) {
-    case MANETTE_MAPPING_DESTINATION_TYPE_AXIS:
-      if (binding->source.range == MANETTE_MAPPING_RANGE_NEGATIVE && value > 0)
-        continue;
-      if (binding->source.range == MANETTE_MAPPING_RANGE_POSITIVE && value < 0)
-        continue;
+  if (G_UNLIKELY (i < n_entries))
+    report_truncation (n_entries, n_mapped_events);
 
-      mapped_event->axis.axis = binding->destination.code;
-      mapped_event->axis.value = abs (value);
+  return n;
+}
 
-      break;
-    case MANETTE_MAPPING_DESTINATION_TYPE_BUTTON:
+gsize
+manette_map_absolute_event (ManetteMapping      *mapping,
+                            ManetteMappingState *state,
+                            guint                index,
+                            double               value,
+                            ManetteMappedEvent  *mapped_events,
+                            gsize                n_mapped_events)
+{
+  const ManetteMappingDispatchEntry *entries;
+  gsize n_entries;
+  gsize n = 0;
+  gsize i;
+
+  entries = manette_mapping_get_dispatch (mapping,
+                                          MANETTE_MAPPING_INPUT_TYPE_AXIS,
+                                          index, &n_entries);
+
+  for (i = 0; i < n_entries && n < n_mapped_events; i++)
+    if (dispatch_value (&entries[i], state,
+                        CLAMP (value, entries[i].min, entries[i].max),
+                        &mapped_events[n]))
+      n++;
+
+  if (G_UNLIKELY (i < n_entries))
+    report_truncation (n_entries, n_mapped_events);
+
+  return n;
+}
+
+gsize
+manette_map_hat_event (ManetteMapping      *mapping,
+                       ManetteMappingState *state,
+                       guint                index,
+                       gint8                value,
+                       ManetteMappedEvent  *mapped_events,
+                       gsize                n_mapped_events)
+{
+  const ManetteMappingDispatchEntry *entries;
+  gsize n_entries;
+  gsize n = 0;
+  gsize i;
+
+  entries = manette_mapping_get_dispatch (mapping,
+                                          MANETTE_MAPPING_INPUT_TYPE_HAT,
+                                          index, &n_entries);
+
+  for (i = 0; i < n_entries && n < n_mapped_events; i++) {
+    const ManetteMappingDispatchEntry *entry = &entries[i];
+
+    if (entry->type == MANETTE_MAPPING_DESTINATION_TYPE_AXIS) {
+      /* Only the half of the hat the axis is bound to moves it */
+      if (value < entry->min || value > entry->max)
+        continue;
+
+      dispatch_value (entry, state, value, &mapped_events[n++]);
+    } else {
       /* Since hat events are most of the time bound to multiple bindings, they
        * will share the same event value. Hence, if the hat is moved left, then
        * it'll be also processed by the mapping for the right dpad for example.
        * But if the dpad is moved quick enough it might skip the neutral point
        * and the direction that was moved from wouldn't be seen as unpressed.
        * Hence, the opposite direction to the current event must be processed
-       * in a way that unpresses the direction that's no longer pressed.
+       * in a way that unpresses the direction that's no longer pressed, which
+       * clamping it to its half does. The state then drops the unpresses of
+       * directions that weren't pressed.
        */
-      if (binding->source.range == MANETTE_MAPPING_RANGE_NEGATIVE && value > 0)
-        pressed = FALSE;
-      else if (binding->source.range == MANETTE_MAPPING_RANGE_POSITIVE && value < 0)
-        pressed = FALSE;
-      else
-        pressed = abs (value);
-
-      mapped_event->button.button = binding->destination.code;
-      mapped_event->button.pressed = pressed;
-
-      break;
-    default:
-      continue;
+      if (dispatch_value (entry, state,
+                          CLAMP (value, entry->min, entry->max),
+                          &mapped_events[n]))
+        n++;
     }
-
-    mapped_events = g_slist_append (mapped_events, mapped_event);
   }
 
-  return mapped_events;
+  if (G_UNLIKELY (i < n_entries))
+    report_truncation (n_entries, n_mapped_events);
+
+  return n;
 }
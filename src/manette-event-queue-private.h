@@ -0,0 +1,52 @@
+/* manette-event-queue-private.h
+ *
+ * Copyright (C) 2026 The libmanette authors
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#if !defined(MANETTE_COMPILATION)
+# error "This file is private, only <libmanette.h> can be included directly."
+#endif
+
+#include <glib.h>
+
+#include "manette-event.h"
+
+G_BEGIN_DECLS
+
+typedef struct _ManetteEventQueue ManetteEventQueue;
+
+ManetteEventQueue *manette_event_queue_new   (guint                capacity,
+                                              ManetteEventOverflow overflow);
+ManetteEventQueue *manette_event_queue_ref   (ManetteEventQueue   *self);
+void               manette_event_queue_unref (ManetteEventQueue   *self);
+
+ManetteEventOverflow manette_event_queue_get_overflow (ManetteEventQueue    *self);
+void                 manette_event_queue_set_overflow (ManetteEventQueue    *self,
+                                                       ManetteEventOverflow  overflow);
+
+void  manette_event_queue_push (ManetteEventQueue  *self,
+                                const ManetteEvent *event);
+gsize manette_event_queue_pop  (ManetteEventQueue  *self,
+                                ManetteEvent       *events,
+                                gsize               n_events);
+
+guint manette_event_queue_get_n_dropped (ManetteEventQueue *self);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (ManetteEventQueue, manette_event_queue_unref)
+
+G_END_DECLS
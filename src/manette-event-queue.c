@@ -0,0 +1,147 @@
+/* manette-event-queue.c
+ *
+ * Copyright (C) 2026 The libmanette authors
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "manette-event-queue-private.h"
+
+#include <string.h>
+
+/* A bounded queue of public events, filled by the devices and the monitor and
+ * drained by the application, all on the monitor's context. It's referenced
+ * by the devices as they can outlive the monitor.
+ */
+struct _ManetteEventQueue {
+  int ref_count;
+
+  ManetteEventOverflow overflow;
+  guint n_dropped;
+
+  guint capacity;
+  guint head;
+  guint length;
+  ManetteEvent events[];
+};
+
+ManetteEventQueue *
+manette_event_queue_new (guint                capacity,
+                         ManetteEventOverflow overflow)
+{
+  ManetteEventQueue *self;
+
+  g_assert (capacity > 0);
+
+  self = g_malloc0 (sizeof (ManetteEventQueue) + capacity * sizeof (ManetteEvent));
+  self->ref_count = 1;
+  self->overflow = overflow;
+  self->capacity = capacity;
+
+  return self;
+}
+
+ManetteEventQueue *
+manette_event_queue_ref (ManetteEventQueue *self)
+{
+  g_assert (self != NULL);
+
+  g_atomic_int_inc (&self->ref_count);
+
+  return self;
+}
+
+void
+manette_event_queue_unref (ManetteEventQueue *self)
+{
+  g_assert (self != NULL);
+
+  if (!g_atomic_int_dec_and_test (&self->ref_count))
+    return;
+
+  g_free (self);
+}
+
+ManetteEventOverflow
+manette_event_queue_get_overflow (ManetteEventQueue *self)
+{
+  g_assert (self != NULL);
+
+  return self->overflow;
+}
+
+void
+manette_event_queue_set_overflow (ManetteEventQueue    *self,
+                                  ManetteEventOverflow  overflow)
+{
+  g_assert (self != NULL);
+
+  self->overflow = overflow;
+}
+
+void
+manette_event_queue_push (ManetteEventQueue  *self,
+                          const ManetteEvent *event)
+{
+  g_assert (self != NULL);
+  g_assert (event != NULL);
+
+  if (self->length == self->capacity) {
+    self->n_dropped++;
+
+    if (self->overflow == MANETTE_EVENT_OVERFLOW_DROP_NEWEST)
+      return;
+
+    self->head = (self->head + 1) % self->capacity;
+    self->length--;
+  }
+
+  self->events[(self->head + self->length) % self->capacity] = *event;
+  self->length++;
+}
+
+/* Moves up to @n_events of the oldest events to @events, in two copies as
+ * they can wrap around.
+ */
+gsize
+manette_event_queue_pop (ManetteEventQueue *self,
+                         ManetteEvent      *events,
+                         gsize              n_events)
+{
+  gsize n_popped, n_first;
+
+  g_assert (self != NULL);
+  g_assert (events != NULL || n_events == 0);
+
+  n_popped = MIN (n_events, self->length);
+  n_first = MIN (n_popped, self->capacity - self->head);
+
+  memcpy (events, &self->events[self->head], n_first * sizeof (ManetteEvent));
+  memcpy (events + n_first, self->events, (n_popped - n_first) * sizeof (ManetteEvent));
+
+  self->head = (self->head + n_popped) % self->capacity;
+  self->length -= n_popped;
+
+  return n_popped;
+}
+
+guint
+manette_event_queue_get_n_dropped (ManetteEventQueue *self)
+{
+  g_assert (self != NULL);
+
+  return self->n_dropped;
+}
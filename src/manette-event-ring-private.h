@@ -0,0 +1,61 @@
+/* manette-event-ring-private.h
+ *
+ * Copyright (C) 2026 The libmanette authors
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#if !defined(MANETTE_COMPILATION)
+# error "This file is private, only <libmanette.h> can be included directly."
+#endif
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef enum {
+  MANETTE_INPUT_EVENT_BUTTON,
+  MANETTE_INPUT_EVENT_AXIS,
+  MANETTE_INPUT_EVENT_UNMAPPED_BUTTON,
+  MANETTE_INPUT_EVENT_UNMAPPED_ABSOLUTE,
+  MANETTE_INPUT_EVENT_UNMAPPED_HAT,
+  MANETTE_INPUT_EVENT_FRAME,
+} ManetteInputEventType;
+
+/* An event as received from a backend. @index is the button or axis for
+ * mapped events, and the hardware index for unmapped ones. Frame events mark
+ * the end of a hardware frame and only have a @time.
+ */
+typedef struct {
+  ManetteInputEventType type;
+  guint index;
+  guint64 time;
+  gboolean pressed;
+  double value;
+  gint8 hat_value;
+} ManetteInputEvent;
+
+typedef void (* ManetteEventRingFunc) (const ManetteInputEvent *event,
+                                       gpointer                 user_data);
+
+GSource *manette_event_ring_new (guint capacity);
+
+gboolean manette_event_ring_push (GSource                 *ring,
+                                  const ManetteInputEvent *event);
+
+guint manette_event_ring_get_n_dropped (GSource *ring);
+
+G_END_DECLS
@@ -0,0 +1,158 @@
+/* manette-event-ring.c
+ *
+ * Copyright (C) 2026 The libmanette authors
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "manette-event-ring-private.h"
+
+/* A bounded single-producer single-consumer queue of events, and the source
+ * dispatching them on the consumer's context.
+ *
+ * The producer only writes tail and the consumer only writes head, both
+ * grow monotonically and wrap around, so the ring needs no lock. Making the
+ * source ready locks and wakes up the consumer's context, so the producer
+ * only does it when the consumer emptied the ring and said it's waiting. The
+ * consumer says so before checking the ring one last time, so no event can
+ * be left behind.
+ */
+typedef struct {
+  GSource parent;
+
+  guint mask;
+  guint head;
+  guint tail;
+  guint n_dropped;
+  gboolean waiting;
+  ManetteInputEvent *events;
+} ManetteEventRing;
+
+static gboolean
+manette_event_ring_dispatch (GSource     *source,
+                             GSourceFunc  callback,
+                             gpointer     user_data)
+{
+  ManetteEventRing *self = (ManetteEventRing *) source;
+  ManetteEventRingFunc func = (ManetteEventRingFunc) callback;
+  guint head = self->head;
+
+  g_source_set_ready_time (source, -1);
+
+  if (func == NULL) {
+    g_atomic_int_set (&self->waiting, TRUE);
+
+    return G_SOURCE_CONTINUE;
+  }
+
+  while (TRUE) {
+    while (head != (guint) g_atomic_int_get (&self->tail)) {
+      ManetteInputEvent event = self->events[head & self->mask];
+
+      head++;
+      g_atomic_int_set (&self->head, head);
+
+      func (&event, user_data);
+
+      /* The callback may have disposed of the consumer */
+      if (g_source_is_destroyed (source))
+        return G_SOURCE_CONTINUE;
+    }
+
+    g_atomic_int_set (&self->waiting, TRUE);
+
+    if (head == (guint) g_atomic_int_get (&self->tail))
+      break;
+
+    /* An event was pushed before the producer could see we are waiting. If
+     * it did see it anyway, the next dispatch will find the ring empty.
+     */
+    g_atomic_int_set (&self->waiting, FALSE);
+  }
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+manette_event_ring_finalize (GSource *source)
+{
+  ManetteEventRing *self = (ManetteEventRing *) source;
+
+  g_free (self->events);
+}
+
+static GSourceFuncs manette_event_ring_funcs = {
+  NULL,
+  NULL,
+  manette_event_ring_dispatch,
+  manette_event_ring_finalize,
+};
+
+/* @capacity must be a power of two. Set the callback with
+ * g_source_set_callback() and a #ManetteEventRingFunc cast to #GSourceFunc.
+ */
+GSource *
+manette_event_ring_new (guint capacity)
+{
+  GSource *source;
+  ManetteEventRing *self;
+
+  g_assert (capacity > 0 && (capacity & (capacity - 1)) == 0);
+
+  source = g_source_new (&manette_event_ring_funcs, sizeof (ManetteEventRing));
+  g_source_set_name (source, "ManetteEventRing");
+
+  self = (ManetteEventRing *) source;
+  self->mask = capacity - 1;
+  self->waiting = TRUE;
+  self->events = g_new0 (ManetteInputEvent, capacity);
+
+  return source;
+}
+
+/* Must only be called from the producer's thread. Returns %FALSE and drops
+ * @event if the ring is full.
+ */
+gboolean
+manette_event_ring_push (GSource                 *ring,
+                         const ManetteInputEvent *event)
+{
+  ManetteEventRing *self = (ManetteEventRing *) ring;
+  guint tail = self->tail;
+
+  if (tail - (guint) g_atomic_int_get (&self->head) > self->mask) {
+    g_atomic_int_inc (&self->n_dropped);
+
+    return FALSE;
+  }
+
+  self->events[tail & self->mask] = *event;
+  g_atomic_int_set (&self->tail, tail + 1);
+
+  /* Only wake the consumer up when it emptied the ring */
+  if (g_atomic_int_compare_and_exchange (&self->waiting, TRUE, FALSE))
+    g_source_set_ready_time (ring, 0);
+
+  return TRUE;
+}
+
+guint
+manette_event_ring_get_n_dropped (GSource *ring)
+{
+  ManetteEventRing *self = (ManetteEventRing *) ring;
+
+  return g_atomic_int_get (&self->n_dropped);
+}
@@ -0,0 +1,68 @@
+/* manette-event.c
+ *
+ * Copyright (C) 2026 The libmanette authors
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "manette-event.h"
+
+/**
+ * ManetteEventType:
+ * @MANETTE_EVENT_DEVICE_CONNECTED: A device was connected
+ * @MANETTE_EVENT_DEVICE_DISCONNECTED: A device was disconnected
+ * @MANETTE_EVENT_BUTTON_PRESSED: A button was pressed
+ * @MANETTE_EVENT_BUTTON_RELEASED: A button was released
+ * @MANETTE_EVENT_ABSOLUTE_AXIS_CHANGED: The value of an axis changed
+ * @MANETTE_EVENT_UNMAPPED_BUTTON_PRESSED: An unmapped button was pressed
+ * @MANETTE_EVENT_UNMAPPED_BUTTON_RELEASED: An unmapped button was released
+ * @MANETTE_EVENT_UNMAPPED_ABSOLUTE_AXIS_CHANGED: The value of an unmapped
+ *     absolute axis changed
+ * @MANETTE_EVENT_UNMAPPED_HAT_AXIS_CHANGED: The value of an unmapped hat axis
+ *     changed
+ * @MANETTE_EVENT_FRAME: A hardware frame ended
+ *
+ * Describes the type of a [struct@Event]. They match the signals of
+ * [class@Monitor] and [class@Device].
+ *
+ * More values may be added to this enumeration over time.
+ */
+
+/**
+ * ManetteEventOverflow:
+ * @MANETTE_EVENT_OVERFLOW_DROP_NEWEST: Drop the events arriving while the
+ *     queue is full
+ * @MANETTE_EVENT_OVERFLOW_DROP_OLDEST: Drop the oldest queued events to make
+ *     room for the new ones
+ *
+ * Describes what [class@Monitor] does with the events arriving while its
+ * event queue is full.
+ */
+
+/**
+ * ManetteEvent:
+ * @type: the type of the event
+ * @device_id: the identifier of the device, see [method@Device.get_id]
+ * @time: the timestamp of the event, in microseconds on the monotonic clock
+ *   like [method@Device.get_current_event_time_usec]
+ * @index: the button or the axis, or the hardware index for unmapped events
+ * @value: the value of the axis, or of the hat axis as -1, 0 or 1
+ *
+ * An event of a device, as returned by [method@Monitor.poll_events].
+ *
+ * @index and @value are only meaningful for the types of events that have
+ * them.
+ */
@@ -0,0 +1,59 @@
+/* manette-event.h
+ *
+ * Copyright (C) 2026 The libmanette authors
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#if !defined(__MANETTE_INSIDE__) && !defined(MANETTE_COMPILATION)
+# error "Only <libmanette.h> can be included directly."
+#endif
+
+#include "manette-version.h"
+
+#include <glib-object.h>
+
+#include "manette-enums.h"
+
+G_BEGIN_DECLS
+
+typedef enum {
+  MANETTE_EVENT_DEVICE_CONNECTED,
+  MANETTE_EVENT_DEVICE_DISCONNECTED,
+  MANETTE_EVENT_BUTTON_PRESSED,
+  MANETTE_EVENT_BUTTON_RELEASED,
+  MANETTE_EVENT_ABSOLUTE_AXIS_CHANGED,
+  MANETTE_EVENT_UNMAPPED_BUTTON_PRESSED,
+  MANETTE_EVENT_UNMAPPED_BUTTON_RELEASED,
+  MANETTE_EVENT_UNMAPPED_ABSOLUTE_AXIS_CHANGED,
+  MANETTE_EVENT_UNMAPPED_HAT_AXIS_CHANGED,
+  MANETTE_EVENT_FRAME,
+} ManetteEventType;
+
+typedef enum {
+  MANETTE_EVENT_OVERFLOW_DROP_NEWEST,
+  MANETTE_EVENT_OVERFLOW_DROP_OLDEST,
+} ManetteEventOverflow;
+
+typedef struct {
+  ManetteEventType type;
+  guint device_id;
+  guint64 time;
+  guint index;
+  double value;
+} ManetteEvent;
+
+G_END_DECLS
@@ -20,6 +20,8 @@
 
 #include "manette-hid-backend-private.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <hidapi.h>
 #include <linux/input.h>
 #include <sys/ioctl.h>
@@ -30,6 +32,9 @@
 #include "manette-device-type-private.h"
 #include "manette-hid-driver-private.h"
 
+/* The largest report hidraw can deliver */
+#define MAX_REPORT_SIZE 4096
+
 struct _ManetteHidBackend
 {
   GObject parent_instance;
@@ -39,7 +44,19 @@ struct _ManetteHidBackend
   ManetteDeviceType device_type;
   ManetteHidDriver *driver;
   char *name;
-  guint event_source_id;
+
+  /* Copied from the device info, which hidapi may query again */
+  int vendor_id;
+  int product_id;
+  int bustype_id;
+  int version_id;
+
+  /* A second handle on the hidraw node, watched to read input reports as soon
+   * as they arrive. hidapi doesn't expose its own.
+   */
+  int fd;
+
+  ManetteBackendEventSink event_sink;
 };
 
 static void manette_hid_backend_backend_init (ManetteBackendInterface *iface);
@@ -48,25 +65,63 @@ G_DEFINE_FINAL_TYPE_WITH_CODE (ManetteHidBackend, manette_hid_backend, G_TYPE_OB
                                G_IMPLEMENT_INTERFACE (MANETTE_TYPE_BACKEND, manette_hid_backend_backend_init))
 
 static gboolean
-poll_events (ManetteHidBackend *self)
+read_reports (GIOChannel        *source,
+              GIOCondition       condition,
+              ManetteHidBackend *self)
 {
-  guint64 time;
+  guint8 buffer[MAX_REPORT_SIZE];
 
   g_assert (MANETTE_IS_HID_BACKEND (self));
 
-  time = g_get_monotonic_time ();
-  manette_hid_driver_poll (self->driver, time);
+  while (TRUE) {
+    ssize_t size = read (self->fd, buffer, sizeof (buffer));
+    gint64 time;
+
+    if (size < 0) {
+      if (errno == EINTR)
+        continue;
+
+      if (errno == EAGAIN)
+        break;
+
+      g_debug ("Failed to read %s: %s", self->filename, g_strerror (errno));
+
+      return G_SOURCE_REMOVE;
+    }
+
+    if (size == 0)
+      break;
+
+    /* hidraw doesn't timestamp the reports, so stamp each of them as it's
+     * read rather than once per wakeup.
+     */
+    time = g_get_monotonic_time ();
+
+    manette_hid_driver_handle_report (self->driver, buffer, size, time);
+    manette_backend_event_sink_emit_frame (&self->event_sink, time);
+  }
+
+  if (condition & (G_IO_HUP | G_IO_ERR))
+    return G_SOURCE_REMOVE;
 
   return G_SOURCE_CONTINUE;
 }
 
+static void
+driver_event_cb (const ManetteInputEvent *event,
+                 ManetteHidBackend       *self)
+{
+  manette_backend_event_sink_emit (&self->event_sink, event);
+}
+
 static void
 manette_hid_backend_finalize (GObject *object)
 {
   ManetteHidBackend *self = MANETTE_HID_BACKEND (object);
 
-  g_clear_handle_id (&self->event_source_id, g_source_remove);
   g_clear_object (&self->driver);
+  if (self->fd >= 0)
+    close (self->fd);
   hid_close (self->hid);
   g_free (self->filename);
   g_free (self->name);
@@ -85,6 +140,26 @@ manette_hid_backend_class_init (ManetteHidBackendClass *klass)
 static void
 manette_hid_backend_init (ManetteHidBackend *self)
 {
+  self->fd = -1;
+}
+
+static int
+get_bustype_id (hid_bus_type bus_type)
+{
+  switch (bus_type) {
+  case HID_API_BUS_UNKNOWN:
+    return 0;
+  case HID_API_BUS_USB:
+    return BUS_USB;
+  case HID_API_BUS_BLUETOOTH:
+    return BUS_BLUETOOTH;
+  case HID_API_BUS_I2C:
+    return BUS_I2C;
+  case HID_API_BUS_SPI:
+    return BUS_SPI;
+  default:
+    g_assert_not_reached ();
+  }
 }
 
 static gboolean
@@ -93,11 +168,13 @@ manette_hid_backend_initialize (ManetteBackend *backend)
   ManetteHidBackend *self = MANETTE_HID_BACKEND (backend);
   const struct hid_device_info *info;
   g_autoptr (GError) error = NULL;
-  guint poll_rate;
 
+  /* Backends are initialized in parallel */
+  G_LOCK (hidapi);
   self->hid = hid_open_path (self->filename);
   if (!self->hid) {
     g_debug ("Failed to open hid device: %ls", hid_error (NULL));
+    G_UNLOCK (hidapi);
     return FALSE;
   }
 
@@ -106,8 +183,15 @@ manette_hid_backend_initialize (ManetteBackend *backend)
   info = hid_get_device_info (self->hid);
   if (!info) {
     g_debug ("Failed to get device info: %ls", hid_error (self->hid));
+    G_UNLOCK (hidapi);
     return FALSE;
   }
+  G_UNLOCK (hidapi);
+
+  self->vendor_id = info->vendor_id;
+  self->product_id = info->product_id;
+  self->bustype_id = get_bustype_id (info->bus_type);
+  self->version_id = info->release_number;
 
   self->device_type = manette_device_type_guess (info->vendor_id, info->product_id);
 
@@ -125,21 +209,38 @@ manette_hid_backend_initialize (ManetteBackend *backend)
     g_assert_not_reached ();
   }
 
-  g_signal_connect_swapped (self->driver, "button-event",
-                            G_CALLBACK (manette_backend_emit_button_event), self);
-  g_signal_connect_swapped (self->driver, "axis-event",
-                            G_CALLBACK (manette_backend_emit_axis_event), self);
+  manette_hid_driver_set_event_func (self->driver,
+                                     (ManetteHidDriverEventFunc) driver_event_cb,
+                                     self);
 
   if (!manette_hid_driver_initialize (self->driver))
     return FALSE;
 
-  // Poll the events in the main loop.
-  poll_rate = manette_hid_driver_get_poll_rate (self->driver);
-  self->event_source_id = g_timeout_add (poll_rate, G_SOURCE_FUNC (poll_events), self);
+  self->fd = open (self->filename, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+  if (self->fd < 0) {
+    g_debug ("Failed to open %s: %s", self->filename, g_strerror (errno));
+
+    return FALSE;
+  }
 
   return TRUE;
 }
 
+static GSource *
+manette_hid_backend_create_source (ManetteBackend *backend)
+{
+  ManetteHidBackend *self = MANETTE_HID_BACKEND (backend);
+  g_autoptr (GIOChannel) channel = NULL;
+  GSource *source;
+
+  // Read the reports as soon as they arrive.
+  channel = g_io_channel_unix_new (self->fd);
+  source = g_io_create_watch (channel, G_IO_IN | G_IO_HUP | G_IO_ERR);
+  g_source_set_callback (source, (GSourceFunc) read_reports, self, NULL);
+
+  return source;
+}
+
 static const char *
 manette_hid_backend_get_name (ManetteBackend *backend)
 {
@@ -164,49 +265,32 @@ static int
 manette_hid_backend_get_vendor_id (ManetteBackend *backend)
 {
   ManetteHidBackend *self = MANETTE_HID_BACKEND (backend);
-  const struct hid_device_info *info = hid_get_device_info (self->hid);
 
-  return info->vendor_id;
+  return self->vendor_id;
 }
 
 static int
 manette_hid_backend_get_product_id (ManetteBackend *backend)
 {
   ManetteHidBackend *self = MANETTE_HID_BACKEND (backend);
-  const struct hid_device_info *info = hid_get_device_info (self->hid);
 
-  return info->product_id;
+  return self->product_id;
 }
 
 static int
 manette_hid_backend_get_bustype_id (ManetteBackend *backend)
 {
   ManetteHidBackend *self = MANETTE_HID_BACKEND (backend);
-  const struct hid_device_info *info = hid_get_device_info (self->hid);
 
-  switch (info->bus_type) {
-  case HID_API_BUS_UNKNOWN:
-    return 0;
-  case HID_API_BUS_USB:
-    return BUS_USB;
-  case HID_API_BUS_BLUETOOTH:
-    return BUS_BLUETOOTH;
-  case HID_API_BUS_I2C:
-    return BUS_I2C;
-  case HID_API_BUS_SPI:
-    return BUS_SPI;
-  default:
-    g_assert_not_reached ();
-  }
+  return self->bustype_id;
 }
 
 static int
 manette_hid_backend_get_version_id (ManetteBackend *backend)
 {
   ManetteHidBackend *self = MANETTE_HID_BACKEND (backend);
-  const struct hid_device_info *info = hid_get_device_info (self->hid);
 
-  return info->release_number;
+  return self->version_id;
 }
 
 void
@@ -264,10 +348,19 @@ manette_hid_backend_rumble (ManetteBackend *backend,
                                     milliseconds);
 }
 
+static ManetteBackendEventSink *
+manette_hid_backend_get_event_sink (ManetteBackend *backend)
+{
+  ManetteHidBackend *self = MANETTE_HID_BACKEND (backend);
+
+  return &self->event_sink;
+}
+
 static void
 manette_hid_backend_backend_init (ManetteBackendInterface *iface)
 {
   iface->initialize = manette_hid_backend_initialize;
+  iface->create_source = manette_hid_backend_create_source;
   iface->get_name = manette_hid_backend_get_name;
   iface->get_vendor_id = manette_hid_backend_get_vendor_id;
   iface->get_product_id = manette_hid_backend_get_product_id;
@@ -279,6 +372,7 @@ manette_hid_backend_backend_init (ManetteBackendInterface *iface)
   iface->has_input = manette_hid_backend_has_input;
   iface->has_rumble = manette_hid_backend_has_rumble;
   iface->rumble = manette_hid_backend_rumble;
+  iface->get_event_sink = manette_hid_backend_get_event_sink;
 }
 
 ManetteBackend *
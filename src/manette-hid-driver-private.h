@@ -24,22 +24,36 @@
 
 #include <glib-object.h>
 
+#include "manette-event-ring-private.h"
 #include "manette-inputs.h"
 
 G_BEGIN_DECLS
 
+/* hidapi initializes itself on the first open and keeps the last error of
+ * each device and of the library, so hold this around opening a device and
+ * around any call whose error is then read with hid_error().
+ */
+G_LOCK_EXTERN (hidapi);
+
 #define MANETTE_TYPE_HID_DRIVER (manette_hid_driver_get_type ())
 
 G_DECLARE_INTERFACE (ManetteHidDriver, manette_hid_driver, MANETTE, HID_DRIVER, GObject)
 
+typedef void (* ManetteHidDriverEventFunc) (const ManetteInputEvent *event,
+                                            gpointer                 user_data);
+
+/* Like ManetteBackendEventSink, embedded in the drivers */
+typedef struct {
+  ManetteHidDriverEventFunc func;
+  gpointer user_data;
+} ManetteHidDriverEventSink;
+
 struct _ManetteHidDriverInterface
 {
   GTypeInterface parent;
 
   gboolean (* initialize) (ManetteHidDriver *self);
 
-  guint (* get_poll_rate) (ManetteHidDriver *self);
-
   char * (* get_name) (ManetteHidDriver *self);
 
   gboolean (* has_button) (ManetteHidDriver *self,
@@ -47,20 +61,22 @@ struct _ManetteHidDriverInterface
   gboolean (* has_axis)   (ManetteHidDriver *self,
                            ManetteAxis       axis);
 
-  void (* poll) (ManetteHidDriver *self,
-                 gint64            time);
+  void (* handle_report) (ManetteHidDriver *self,
+                          const guint8     *data,
+                          gsize             length,
+                          gint64            time);
 
   gboolean (* has_rumble) (ManetteHidDriver *self);
   gboolean (* rumble)     (ManetteHidDriver *self,
                            guint16           strong_magnitude,
                            guint16           weak_magnitude,
                            guint16           milliseconds);
+
+  ManetteHidDriverEventSink * (* get_event_sink) (ManetteHidDriver *self);
 };
 
 gboolean manette_hid_driver_initialize (ManetteHidDriver *self);
 
-guint manette_hid_driver_get_poll_rate (ManetteHidDriver *self);
-
 char *manette_hid_driver_get_name (ManetteHidDriver *self);
 
 gboolean manette_hid_driver_has_button (ManetteHidDriver *self,
@@ -68,8 +84,10 @@ gboolean manette_hid_driver_has_button (ManetteHidDriver *self,
 gboolean manette_hid_driver_has_axis   (ManetteHidDriver *self,
                                         ManetteAxis       axis);
 
-void manette_hid_driver_poll (ManetteHidDriver *self,
-                              gint64            time);
+void manette_hid_driver_handle_report (ManetteHidDriver *self,
+                                       const guint8     *data,
+                                       gsize             length,
+                                       gint64            time);
 
 gboolean manette_hid_driver_has_rumble (ManetteHidDriver *self);
 
@@ -78,13 +96,19 @@ gboolean manette_hid_driver_rumble (ManetteHidDriver *self,
                                     guint16           weak_magnitude,
                                     guint16           milliseconds);
 
-void manette_hid_driver_emit_button_event (ManetteHidDriver *self,
-                                           guint64           time,
-                                           ManetteButton     button,
-                                           gboolean          pressed);
-void manette_hid_driver_emit_axis_event   (ManetteHidDriver *self,
-                                           guint64           time,
-                                           ManetteAxis       axis,
-                                           double            value);
+ManetteHidDriverEventSink *manette_hid_driver_get_event_sink (ManetteHidDriver *self);
+
+void manette_hid_driver_set_event_func (ManetteHidDriver          *self,
+                                        ManetteHidDriverEventFunc  func,
+                                        gpointer                   user_data);
+
+void manette_hid_driver_event_sink_emit_button (ManetteHidDriverEventSink *sink,
+                                                guint64                    time,
+                                                ManetteButton              button,
+                                                gboolean                   pressed);
+void manette_hid_driver_event_sink_emit_axis   (ManetteHidDriverEventSink *sink,
+                                                guint64                    time,
+                                                ManetteAxis                axis,
+                                                double                     value);
 
 G_END_DECLS
@@ -22,13 +22,7 @@
 
 G_DEFINE_INTERFACE (ManetteHidDriver, manette_hid_driver, G_TYPE_OBJECT)
 
-enum {
-  SIGNAL_BUTTON_EVENT,
-  SIGNAL_AXIS_EVENT,
-  SIGNAL_LAST_SIGNAL,
-};
-
-static guint signals[SIGNAL_LAST_SIGNAL];
+G_LOCK_DEFINE (hidapi);
 
 static char *
 manette_hid_driver_real_get_name (ManetteHidDriver *self)
@@ -57,26 +51,6 @@ manette_hid_driver_default_init (ManetteHidDriverInterface *iface)
   iface->get_name = manette_hid_driver_real_get_name;
   iface->has_rumble = manette_hid_driver_real_has_rumble;
   iface->rumble = manette_hid_driver_real_rumble;
-
-  signals[SIGNAL_BUTTON_EVENT] =
-    g_signal_new ("button-event",
-                  G_TYPE_FROM_INTERFACE (iface),
-                  G_SIGNAL_RUN_FIRST,
-                  0,
-                  NULL, NULL, NULL,
-                  G_TYPE_NONE,
-                  3,
-                  G_TYPE_UINT64, G_TYPE_UINT, G_TYPE_BOOLEAN);
-
-  signals[SIGNAL_AXIS_EVENT] =
-    g_signal_new ("axis-event",
-                  G_TYPE_FROM_INTERFACE (iface),
-                  G_SIGNAL_RUN_FIRST,
-                  0,
-                  NULL, NULL, NULL,
-                  G_TYPE_NONE,
-                  3,
-                  G_TYPE_UINT64, MANETTE_TYPE_AXIS, G_TYPE_DOUBLE);
 }
 
 gboolean
@@ -93,20 +67,6 @@ manette_hid_driver_initialize (ManetteHidDriver *self)
   return iface->initialize (self);
 }
 
-guint
-manette_hid_driver_get_poll_rate (ManetteHidDriver *self)
-{
-  ManetteHidDriverInterface *iface;
-
-  g_assert (MANETTE_IS_HID_DRIVER (self));
-
-  iface = MANETTE_HID_DRIVER_GET_IFACE (self);
-
-  g_assert (iface->get_poll_rate);
-
-  return iface->get_poll_rate (self);
-}
-
 char *
 manette_hid_driver_get_name (ManetteHidDriver *self)
 {
@@ -152,18 +112,21 @@ manette_hid_driver_has_axis (ManetteHidDriver *self,
 }
 
 void
-manette_hid_driver_poll (ManetteHidDriver *self,
-                         gint64            time)
+manette_hid_driver_handle_report (ManetteHidDriver *self,
+                                  const guint8     *data,
+                                  gsize             length,
+                                  gint64            time)
 {
   ManetteHidDriverInterface *iface;
 
   g_assert (MANETTE_IS_HID_DRIVER (self));
+  g_assert (data != NULL);
 
   iface = MANETTE_HID_DRIVER_GET_IFACE (self);
 
-  g_assert (iface->poll);
+  g_assert (iface->handle_report);
 
-  iface->poll (self, time);
+  iface->handle_report (self, data, length, time);
 }
 
 gboolean
@@ -198,26 +161,74 @@ manette_hid_driver_rumble (ManetteHidDriver *self,
   return iface->rumble (self, strong_magnitude, weak_magnitude, milliseconds);
 }
 
-void
-manette_hid_driver_emit_button_event (ManetteHidDriver *self,
-                                      guint64           time,
-                                      ManetteButton     button,
-                                      gboolean          pressed)
+/* Like manette_backend_get_event_sink(), the drivers embed their sink */
+ManetteHidDriverEventSink *
+manette_hid_driver_get_event_sink (ManetteHidDriver *self)
 {
+  ManetteHidDriverInterface *iface;
+
   g_assert (MANETTE_IS_HID_DRIVER (self));
 
-  pressed = !!pressed;
+  iface = MANETTE_HID_DRIVER_GET_IFACE (self);
+
+  g_assert (iface->get_event_sink);
 
-  g_signal_emit (self, signals[SIGNAL_BUTTON_EVENT], 0, time, button, pressed);
+  return iface->get_event_sink (self);
 }
 
+/* Like manette_backend_set_event_func(), the events are passed directly */
 void
-manette_hid_driver_emit_axis_event (ManetteHidDriver *self,
-                                    guint64           time,
-                                    ManetteAxis       axis,
-                                    double            value)
+manette_hid_driver_set_event_func (ManetteHidDriver          *self,
+                                   ManetteHidDriverEventFunc  func,
+                                   gpointer                   user_data)
 {
+  ManetteHidDriverEventSink *sink;
+
   g_assert (MANETTE_IS_HID_DRIVER (self));
 
-  g_signal_emit (self, signals[SIGNAL_AXIS_EVENT], 0, time, axis, value);
+  sink = manette_hid_driver_get_event_sink (self);
+  sink->func = func;
+  sink->user_data = user_data;
+}
+
+static inline void
+emit_event (ManetteHidDriverEventSink *sink,
+            const ManetteInputEvent   *event)
+{
+  g_assert (sink != NULL);
+
+  if (G_LIKELY (sink->func))
+    sink->func (event, sink->user_data);
+}
+
+void
+manette_hid_driver_event_sink_emit_button (ManetteHidDriverEventSink *sink,
+                                           guint64                    time,
+                                           ManetteButton              button,
+                                           gboolean                   pressed)
+{
+  ManetteInputEvent event = {
+    .type = MANETTE_INPUT_EVENT_BUTTON,
+    .index = button,
+    .time = time,
+    .pressed = !!pressed,
+  };
+
+  emit_event (sink, &event);
+}
+
+void
+manette_hid_driver_event_sink_emit_axis (ManetteHidDriverEventSink *sink,
+                                         guint64                    time,
+                                         ManetteAxis                axis,
+                                         double                     value)
+{
+  ManetteInputEvent event = {
+    .type = MANETTE_INPUT_EVENT_AXIS,
+    .index = axis,
+    .time = time,
+    .value = value,
+  };
+
+  emit_event (sink, &event);
 }
@@ -0,0 +1,42 @@
+/* manette-input-thread-private.h
+ *
+ * Copyright (C) 2026 The libmanette authors
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#if !defined(MANETTE_COMPILATION)
+# error "This file is private, only <libmanette.h> can be included directly."
+#endif
+
+#include <glib.h>
+
+G_BEGIN_DECLS
+
+typedef struct _ManetteInputThread ManetteInputThread;
+
+ManetteInputThread *manette_input_thread_new (void);
+ManetteInputThread *manette_input_thread_ref (ManetteInputThread *self);
+void manette_input_thread_unref (ManetteInputThread *self);
+
+GMainContext *manette_input_thread_get_context (ManetteInputThread *self);
+
+void manette_input_thread_destroy_source (ManetteInputThread *self,
+                                          GSource            *source);
+
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (ManetteInputThread, manette_input_thread_unref)
+
+G_END_DECLS
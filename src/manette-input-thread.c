@@ -0,0 +1,165 @@
+/* manette-input-thread.c
+ *
+ * Copyright (C) 2026 The libmanette authors
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "config.h"
+
+#include "manette-input-thread-private.h"
+
+/* A thread running its own main context, on which devices can read and map
+ * their events without being delayed by the application's main loop. It keeps
+ * running as long as it's referenced, so the sources attached to it can
+ * always be destroyed synchronously.
+ */
+struct _ManetteInputThread {
+  int ref_count;
+
+  GThread *thread;
+  GMainContext *context;
+  GMainLoop *loop;
+};
+
+typedef struct {
+  GSource *source;
+  GMutex mutex;
+  GCond cond;
+  gboolean done;
+} DestroySourceData;
+
+static gpointer
+input_thread_func (ManetteInputThread *self)
+{
+  g_main_context_push_thread_default (self->context);
+  g_main_loop_run (self->loop);
+  g_main_context_pop_thread_default (self->context);
+
+  return NULL;
+}
+
+ManetteInputThread *
+manette_input_thread_new (void)
+{
+  ManetteInputThread *self = g_new0 (ManetteInputThread, 1);
+
+  self->ref_count = 1;
+  self->context = g_main_context_new ();
+  self->loop = g_main_loop_new (self->context, FALSE);
+  self->thread = g_thread_new ("manette-input",
+                               (GThreadFunc) input_thread_func,
+                               self);
+
+  return self;
+}
+
+ManetteInputThread *
+manette_input_thread_ref (ManetteInputThread *self)
+{
+  g_assert (self != NULL);
+
+  g_atomic_int_inc (&self->ref_count);
+
+  return self;
+}
+
+static gboolean
+quit_loop_cb (GMainLoop *loop)
+{
+  g_main_loop_quit (loop);
+
+  return G_SOURCE_REMOVE;
+}
+
+void
+manette_input_thread_unref (ManetteInputThread *self)
+{
+  g_autoptr (GSource) quit_source = NULL;
+
+  g_assert (self != NULL);
+
+  if (!g_atomic_int_dec_and_test (&self->ref_count))
+    return;
+
+  g_assert (g_thread_self () != self->thread);
+
+  /* Quit from the loop itself, as quitting it before it runs would be
+   * ignored, see manette_steam_deck_driver_finalize().
+   */
+  quit_source = g_idle_source_new ();
+  g_source_set_priority (quit_source, G_PRIORITY_HIGH);
+  g_source_set_callback (quit_source, G_SOURCE_FUNC (quit_loop_cb), self->loop, NULL);
+  g_source_attach (quit_source, self->context);
+
+  g_thread_join (self->thread);
+
+  g_main_loop_unref (self->loop);
+  g_main_context_unref (self->context);
+  g_free (self);
+}
+
+GMainContext *
+manette_input_thread_get_context (ManetteInputThread *self)
+{
+  g_assert (self != NULL);
+
+  return self->context;
+}
+
+static gboolean
+destroy_source_cb (DestroySourceData *data)
+{
+  g_source_destroy (data->source);
+
+  g_mutex_lock (&data->mutex);
+  data->done = TRUE;
+  g_cond_signal (&data->cond);
+  g_mutex_unlock (&data->mutex);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Destroys @source, which must be attached to the context of @self, and
+ * waits for it to be destroyed. Once this returns, its callback is not and
+ * will never be running.
+ */
+void
+manette_input_thread_destroy_source (ManetteInputThread *self,
+                                     GSource            *source)
+{
+  DestroySourceData data = { source, };
+
+  g_assert (self != NULL);
+  g_assert (source != NULL);
+
+  if (g_thread_self () == self->thread) {
+    g_source_destroy (source);
+
+    return;
+  }
+
+  g_mutex_init (&data.mutex);
+  g_cond_init (&data.cond);
+
+  g_main_context_invoke (self->context, G_SOURCE_FUNC (destroy_source_cb), &data);
+
+  g_mutex_lock (&data.mutex);
+  while (!data.done)
+    g_cond_wait (&data.cond, &data.mutex);
+  g_mutex_unlock (&data.mutex);
+
+  g_mutex_clear (&data.mutex);
+  g_cond_clear (&data.cond);
+}
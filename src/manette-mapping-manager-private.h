@@ -31,6 +31,7 @@ G_BEGIN_DECLS
 G_DECLARE_FINAL_TYPE (ManetteMappingManager, manette_mapping_manager, MANETTE, MAPPING_MANAGER, GObject)
 
 ManetteMappingManager *manette_mapping_manager_new (void);
+ManetteMappingManager *manette_mapping_manager_dup_default (void);
 gboolean manette_mapping_manager_has_user_mapping (ManetteMappingManager *self,
                                                    const char            *guid);
 char *manette_mapping_manager_get_default_mapping (ManetteMappingManager *self,
@@ -26,17 +26,64 @@
 #include <string.h>
 #include <gio/gio.h>
 
+#define GUID_LENGTH 32
+
+/* The default mappings are compiled at build time by
+ * tools/compile-gamecontrollerdb.py, which documents the format. Only the
+ * mappings we support are kept, and the entries are sorted by GUID.
+ */
+#define MAPPING_DB_MAGIC "MANETTE1"
+
+typedef struct {
+  char magic[8];
+  guint32 n_entries;
+  guint32 reserved;
+} MappingDbHeader;
+
+typedef struct {
+  char guid[GUID_LENGTH];
+  guint32 mapping_offset;
+  guint32 mapping_length;
+} MappingDbEntry;
+
+G_STATIC_ASSERT (sizeof (MappingDbHeader) == 16);
+G_STATIC_ASSERT (sizeof (MappingDbEntry) == 40);
+
 struct _ManetteMappingManager {
   GObject parent_instance;
 
+  /* The compiled default mappings, looked up in place */
+  GBytes *default_db;
+  const MappingDbEntry *default_entries;
+  gsize n_default_entries;
+
   /* Associates the GUID with the device's name */
   GHashTable *names;
-  /* Those two associates a GUID with its full corresponding SDL mapping string */
-  GHashTable *default_mappings;
+  /* Associates a GUID with its full corresponding SDL mapping string */
   GHashTable *user_mappings;
 
   char *user_mappings_uri;
   GFileMonitor *user_mappings_monitor;
+
+  /* A save is written right away, the ones following it are delayed until
+   * they stop coming in bursts, on the context the manager was created on.
+   * Reloads are delayed the same way. The pending sources keep the manager
+   * alive until they ran. The entity tag of the version of the file we last
+   * wrote or read lets us skip reloading it, e.g. after our own writes.
+   */
+  GMainContext *context;
+  GSource *save_source;
+  gboolean save_pending;
+  gboolean writing;
+  GSource *reload_source;
+  char *etag;
+
+  /* Protects the fields above, the manager is shared process-wide */
+  GMutex lock;
+  /* Serializes the writes, which happen without holding the lock so the
+   * lookups don't wait for the disk. Taken before the lock.
+   */
+  GMutex write_lock;
 };
 
 G_DEFINE_FINAL_TYPE (ManetteMappingManager, manette_mapping_manager, G_TYPE_OBJECT);
@@ -48,12 +95,103 @@ enum {
 
 static guint signals[N_SIGNALS];
 
+#define SAVE_DELAY_MS 200
+#define RELOAD_DELAY_MS 200
+
 #define CONFIG_DIR "libmanette"
 #define MAPPING_CONFIG_FILE "gamecontrollerdb"
-#define MAPPING_RESOURCE_URI "resource:///org/gnome/Manette/gamecontrollerdb"
+#define MAPPING_DB_RESOURCE_PATH "/org/gnome/Manette/gamecontrollerdb.bin"
+
+G_LOCK_DEFINE_STATIC (default_manager);
+static GWeakRef default_manager;
 
 /* Private */
 
+static gboolean
+load_default_db (ManetteMappingManager  *self,
+                 GError                **error)
+{
+  const MappingDbHeader *header;
+  gsize size;
+  guint32 n_entries;
+
+  self->default_db = g_resources_lookup_data (MAPPING_DB_RESOURCE_PATH,
+                                              G_RESOURCE_LOOKUP_FLAGS_NONE,
+                                              error);
+  if (self->default_db == NULL)
+    return FALSE;
+
+  header = g_bytes_get_data (self->default_db, &size);
+  if (size < sizeof (MappingDbHeader) ||
+      memcmp (header->magic, MAPPING_DB_MAGIC, sizeof (header->magic)) != 0) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                 "Invalid mapping database header");
+    g_clear_pointer (&self->default_db, g_bytes_unref);
+
+    return FALSE;
+  }
+
+  n_entries = GUINT32_FROM_LE (header->n_entries);
+  if ((size - sizeof (MappingDbHeader)) / sizeof (MappingDbEntry) < n_entries) {
+    g_set_error (error, G_IO_ERROR, G_IO_ERROR_INVALID_DATA,
+                 "Truncated mapping database");
+    g_clear_pointer (&self->default_db, g_bytes_unref);
+
+    return FALSE;
+  }
+
+  self->default_entries = (const MappingDbEntry *) (header + 1);
+  self->n_default_entries = n_entries;
+
+  return TRUE;
+}
+
+static int
+compare_db_entry (const void *guid,
+                  const void *entry)
+{
+  return memcmp (guid, ((const MappingDbEntry *) entry)->guid, GUID_LENGTH);
+}
+
+/* Returns the mapping string in place, it's valid as long as @self is. */
+static const char *
+get_entry_mapping (ManetteMappingManager *self,
+                   const MappingDbEntry  *entry)
+{
+  const char *data;
+  gsize size, offset, length;
+
+  data = g_bytes_get_data (self->default_db, &size);
+  offset = GUINT32_FROM_LE (entry->mapping_offset);
+  length = GUINT32_FROM_LE (entry->mapping_length);
+
+  if (offset >= size || size - offset <= length || data[offset + length] != '\0') {
+    g_debug ("ManetteMappingManager: Invalid mapping database entry for %.*s",
+             GUID_LENGTH, entry->guid);
+
+    return NULL;
+  }
+
+  return data + offset;
+}
+
+static const char *
+lookup_default_mapping (ManetteMappingManager *self,
+                        const char            *guid)
+{
+  const MappingDbEntry *entry;
+
+  if (self->default_db == NULL || strlen (guid) != GUID_LENGTH)
+    return NULL;
+
+  entry = bsearch (guid, self->default_entries, self->n_default_entries,
+                   sizeof (MappingDbEntry), compare_db_entry);
+  if (entry == NULL)
+    return NULL;
+
+  return get_entry_mapping (self, entry);
+}
+
 static void
 add_mapping (ManetteMappingManager *self,
              const char            *mapping_string,
@@ -150,23 +288,20 @@ add_from_file_uri (ManetteMappingManager  *self,
   }
 }
 
-static void
-save_user_mappings (ManetteMappingManager  *self,
-                    GError                **error)
+/* Returns the entity tag of the written file. */
+static char *
+save_user_mappings (const char  *uri,
+                    GPtrArray   *mappings,
+                    GError     **error)
 {
-  GHashTableIter iter;
-  char *guid;
-  char *sdl_string;
-  const char *name;
-  g_autofree char *mapping_string = NULL;
-
   g_autoptr (GFile) file = NULL;
   g_autoptr (GFile) directory = NULL;
   g_autoptr (GFileOutputStream) stream = NULL;
   g_autoptr (GDataOutputStream) data_stream = NULL;
   GError *inner_error = NULL;
+  guint i;
 
-  file = g_file_new_for_uri (self->user_mappings_uri);
+  file = g_file_new_for_uri (uri);
   directory = g_file_get_parent (file);
 
   if (!g_file_query_exists (directory, NULL)) {
@@ -174,7 +309,7 @@ save_user_mappings (ManetteMappingManager  *self,
     if (G_UNLIKELY (inner_error != NULL)) {
       g_propagate_error (error, inner_error);
 
-      return;
+      return NULL;
     }
   }
 
@@ -182,53 +317,229 @@ save_user_mappings (ManetteMappingManager  *self,
   if (G_UNLIKELY (inner_error != NULL)) {
     g_propagate_error (error, inner_error);
 
-    return;
+    return NULL;
   }
   data_stream = g_data_output_stream_new (G_OUTPUT_STREAM (stream));
 
-  g_hash_table_iter_init (&iter, self->user_mappings);
-  while (g_hash_table_iter_next (&iter, (gpointer) &guid, (gpointer) &sdl_string)) {
-    name = g_hash_table_lookup (self->names, guid);
-
-    mapping_string = g_strdup_printf ("%s,%s,%s\n", guid, name, sdl_string);
+  for (i = 0; i < mappings->len; i++) {
+    g_autofree char *line = g_strdup_printf ("%s\n", (char *) g_ptr_array_index (mappings, i));
 
-    g_data_output_stream_put_string (data_stream, mapping_string, NULL, &inner_error);
+    g_data_output_stream_put_string (data_stream, line, NULL, &inner_error);
     if (G_UNLIKELY (inner_error != NULL)) {
       g_propagate_error (error, inner_error);
 
-      return;
+      return NULL;
     }
   }
+
+  g_output_stream_close (G_OUTPUT_STREAM (data_stream), NULL, &inner_error);
+  if (G_UNLIKELY (inner_error != NULL)) {
+    g_propagate_error (error, inner_error);
+
+    return NULL;
+  }
+
+  return g_file_output_stream_get_etag (stream);
 }
 
 static void
-user_mappings_changed_cb (GFileMonitor          *monitor,
-                          GFile                 *file,
-                          GFile                 *other_file,
-                          GFileMonitorEvent      event_type,
-                          ManetteMappingManager *self)
+schedule (ManetteMappingManager *self,
+          GSource              **source,
+          guint                  delay,
+          GSourceFunc            func)
+{
+  GSource *old_source = *source;
+
+  /* Create the new source first, so destroying the old one can't drop the
+   * last reference to @self while its lock is held.
+   */
+  *source = g_timeout_source_new (delay);
+  g_source_set_callback (*source, func, g_object_ref (self), g_object_unref);
+  g_source_attach (*source, self->context);
+
+  if (old_source != NULL) {
+    g_source_destroy (old_source);
+    g_source_unref (old_source);
+  }
+}
+
+/* Writes a copy of the user mappings, must be called without the lock held. */
+static void
+write_user_mappings (ManetteMappingManager *self)
+{
+  g_autoptr (GPtrArray) mappings = NULL;
+  g_autoptr (GError) error = NULL;
+  g_autofree char *etag = NULL;
+  GHashTableIter iter;
+  const char *mapping_string;
+
+  g_mutex_lock (&self->write_lock);
+
+  g_mutex_lock (&self->lock);
+  mappings = g_ptr_array_new_full (g_hash_table_size (self->user_mappings), g_free);
+  g_hash_table_iter_init (&iter, self->user_mappings);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer) &mapping_string))
+    g_ptr_array_add (mappings, g_strdup (mapping_string));
+  self->writing = TRUE;
+  g_mutex_unlock (&self->lock);
+
+  etag = save_user_mappings (self->user_mappings_uri, mappings, &error);
+
+  g_mutex_lock (&self->lock);
+  self->writing = FALSE;
+  if (etag != NULL) {
+    g_free (self->etag);
+    self->etag = g_steal_pointer (&etag);
+  }
+  g_mutex_unlock (&self->lock);
+
+  g_mutex_unlock (&self->write_lock);
+
+  if (G_UNLIKELY (error != NULL))
+    g_critical ("ManetteMappingManager: Can’t save user mappings: %s", error->message);
+}
+
+static gboolean
+save_cb (ManetteMappingManager *self)
+{
+  gboolean save_pending;
+
+  g_mutex_lock (&self->lock);
+
+  g_clear_pointer (&self->save_source, g_source_unref);
+  save_pending = self->save_pending;
+  self->save_pending = FALSE;
+
+  g_mutex_unlock (&self->lock);
+
+  if (save_pending)
+    write_user_mappings (self);
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Returns whether to write the user mappings right away, that is unless we
+ * just did, in which case the write is delayed until the saves stop coming.
+ * This way a single save reaches the disk even if the context is never
+ * iterated again, and bursts of saves still write the file only twice.
+ *
+ * Must be called with the lock held, the write must happen after releasing it.
+ */
+static gboolean
+request_save (ManetteMappingManager *self)
+{
+  gboolean write_now = self->save_source == NULL;
+
+  if (!write_now)
+    self->save_pending = TRUE;
+
+  schedule (self, &self->save_source, SAVE_DELAY_MS, (GSourceFunc) save_cb);
+
+  return write_now;
+}
+
+/* Adds to @changed the GUIDs whose mapping differs between @old and @new. */
+static void
+diff_mappings (GHashTable *old,
+               GHashTable *new,
+               GPtrArray  *changed)
+{
+  GHashTableIter iter;
+  const char *guid;
+  const char *mapping;
+
+  g_hash_table_iter_init (&iter, old);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &guid, (gpointer *) &mapping))
+    if (g_strcmp0 (mapping, g_hash_table_lookup (new, guid)) != 0)
+      g_ptr_array_add (changed, g_strdup (guid));
+
+  g_hash_table_iter_init (&iter, new);
+  while (g_hash_table_iter_next (&iter, (gpointer *) &guid, NULL))
+    if (!g_hash_table_contains (old, guid))
+      g_ptr_array_add (changed, g_strdup (guid));
+}
+
+static char *
+query_etag (GFile *file)
+{
+  g_autoptr (GFileInfo) info = NULL;
+
+  info = g_file_query_info (file, G_FILE_ATTRIBUTE_ETAG_VALUE,
+                            G_FILE_QUERY_INFO_NONE, NULL, NULL);
+  if (info == NULL)
+    return NULL;
+
+  return g_strdup (g_file_info_get_etag (info));
+}
+
+static gboolean
+reload_cb (ManetteMappingManager *self)
 {
   g_autoptr (GFile) user_mappings_file = NULL;
+  g_autoptr (GHashTable) user_mappings = NULL;
+  g_autoptr (GPtrArray) changed = NULL;
   g_autoptr (GError) error = NULL;
+  g_autofree char *etag = NULL;
+  guint i;
 
-  g_hash_table_remove_all (self->user_mappings);
+  g_mutex_lock (&self->lock);
 
-  if (G_UNLIKELY (event_type == G_FILE_MONITOR_EVENT_DELETED)) {
-    g_signal_emit (self, signals[SIG_CHANGED], 0);
+  g_clear_pointer (&self->reload_source, g_source_unref);
 
-    return;
+  /* A pending or ongoing save will overwrite the file anyway */
+  if (self->save_pending || self->writing) {
+    g_mutex_unlock (&self->lock);
+
+    return G_SOURCE_REMOVE;
   }
 
   user_mappings_file = g_file_new_for_uri (self->user_mappings_uri);
+  etag = query_etag (user_mappings_file);
+  if (etag != NULL && g_strcmp0 (etag, self->etag) == 0) {
+    g_mutex_unlock (&self->lock);
+
+    return G_SOURCE_REMOVE;
+  }
+
+  g_free (self->etag);
+  self->etag = g_steal_pointer (&etag);
+
+  user_mappings = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+  changed = g_ptr_array_new_with_free_func (g_free);
+
   if (g_file_query_exists (user_mappings_file, NULL))
-    add_from_file_uri (self, self->user_mappings_uri, self->user_mappings, &error);
+    add_from_file_uri (self, self->user_mappings_uri, user_mappings, &error);
+
+  /* Only notify about the devices whose mapping actually changed */
+  diff_mappings (self->user_mappings, user_mappings, changed);
+  g_clear_pointer (&self->user_mappings, g_hash_table_unref);
+  self->user_mappings = g_steal_pointer (&user_mappings);
+
+  g_mutex_unlock (&self->lock);
+
   if (G_UNLIKELY (error != NULL)) {
     g_debug ("ManetteMappingManager: Can’t add mappings from %s: %s",
              self->user_mappings_uri,
              error->message);
   }
 
-  g_signal_emit (self, signals[SIG_CHANGED], 0);
+  for (i = 0; i < changed->len; i++)
+    g_signal_emit (self, signals[SIG_CHANGED], 0, g_ptr_array_index (changed, i));
+
+  return G_SOURCE_REMOVE;
+}
+
+static void
+user_mappings_changed_cb (GFileMonitor          *monitor,
+                          GFile                 *file,
+                          GFile                 *other_file,
+                          GFileMonitorEvent      event_type,
+                          ManetteMappingManager *self)
+{
+  /* Writing a file generates several events, reload once they are over */
+  g_mutex_lock (&self->lock);
+  schedule (self, &self->reload_source, RELOAD_DELAY_MS, (GSourceFunc) reload_cb);
+  g_mutex_unlock (&self->lock);
 }
 
 /* Public */
@@ -243,18 +554,17 @@ manette_mapping_manager_new (void)
 
   self = (ManetteMappingManager*) g_object_new (MANETTE_TYPE_MAPPING_MANAGER, NULL);
 
+  self->context = g_main_context_ref_thread_default ();
+
   if (self->names == NULL)
     self->names = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
-  if (self->default_mappings == NULL)
-    self->default_mappings = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
   if (self->user_mappings == NULL)
     self->user_mappings = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
 
-  add_from_file_uri (self, MAPPING_RESOURCE_URI, self->default_mappings, &error);
-  if (G_UNLIKELY (error != NULL)) {
-    g_critical ("ManetteMappingManager: Can’t add mappings from %s: %s",
-                MAPPING_RESOURCE_URI,
+  if (!load_default_db (self, &error)) {
+    g_critical ("ManetteMappingManager: Can’t load mappings from %s: %s",
+                MAPPING_DB_RESOURCE_PATH,
                 error->message);
     g_clear_error (&error);
   }
@@ -287,8 +597,10 @@ manette_mapping_manager_new (void)
                     G_CALLBACK (user_mappings_changed_cb),
                     self);
 
-  if (g_file_query_exists (user_mappings_file, NULL))
+  if (g_file_query_exists (user_mappings_file, NULL)) {
+    self->etag = query_etag (user_mappings_file);
     add_from_file_uri (self, self->user_mappings_uri, self->user_mappings, &error);
+  }
   if (G_UNLIKELY (error != NULL)) {
     g_debug ("ManetteMappingManager: Can’t add mappings from %s: %s",
              self->user_mappings_uri,
@@ -299,42 +611,78 @@ manette_mapping_manager_new (void)
   return self;
 }
 
+/**
+ * manette_mapping_manager_dup_default:
+ *
+ * Gets the mapping manager shared by all devices and monitors of the process,
+ * creating it if there isn't any alive.
+ *
+ * The mapping database is parsed only when the shared manager is created, so
+ * prefer this over manette_mapping_manager_new() for lookups.
+ *
+ * This function is thread-safe.
+ *
+ * Returns: (transfer full): the shared mapping manager
+ */
+ManetteMappingManager *
+manette_mapping_manager_dup_default (void)
+{
+  ManetteMappingManager *self;
+
+  G_LOCK (default_manager);
+
+  self = g_weak_ref_get (&default_manager);
+  if (self == NULL) {
+    self = manette_mapping_manager_new ();
+    g_weak_ref_set (&default_manager, self);
+  }
+
+  G_UNLOCK (default_manager);
+
+  return self;
+}
+
 gboolean
 manette_mapping_manager_has_user_mapping (ManetteMappingManager *self,
                                           const char            *guid)
 {
+  gboolean result;
+
   g_return_val_if_fail (MANETTE_IS_MAPPING_MANAGER (self), FALSE);
   g_return_val_if_fail (guid != NULL, FALSE);
 
-  return g_hash_table_contains (self->user_mappings, guid);
+  g_mutex_lock (&self->lock);
+  result = g_hash_table_contains (self->user_mappings, guid);
+  g_mutex_unlock (&self->lock);
+
+  return result;
 }
 
 char *
 manette_mapping_manager_get_default_mapping (ManetteMappingManager *self,
                                              const char            *guid)
 {
-  const char *mapping;
-
   g_return_val_if_fail (MANETTE_IS_MAPPING_MANAGER (self), NULL);
   g_return_val_if_fail (guid != NULL, NULL);
 
-  mapping = g_hash_table_lookup (self->default_mappings, guid);
-
-  return g_strdup (mapping);
+  /* The default mappings are immutable, no need to lock */
+  return g_strdup (lookup_default_mapping (self, guid));
 }
 
 char *
 manette_mapping_manager_get_user_mapping (ManetteMappingManager *self,
                                           const char            *guid)
 {
-  const char *mapping;
+  char *mapping;
 
   g_return_val_if_fail (MANETTE_IS_MAPPING_MANAGER (self), NULL);
   g_return_val_if_fail (guid != NULL, NULL);
 
-  mapping = g_hash_table_lookup (self->user_mappings, guid);
+  g_mutex_lock (&self->lock);
+  mapping = g_strdup (g_hash_table_lookup (self->user_mappings, guid));
+  g_mutex_unlock (&self->lock);
 
-  return g_strdup (mapping);
+  return mapping;
 }
 
 char *
@@ -359,44 +707,74 @@ manette_mapping_manager_save_mapping (ManetteMappingManager *self,
                                       const char            *name,
                                       const char            *mapping)
 {
-  g_autoptr (GError) error = NULL;
+  gboolean write_now;
 
   g_return_if_fail (MANETTE_IS_MAPPING_MANAGER (self));
   g_return_if_fail (guid != NULL);
   g_return_if_fail (name != NULL);
   g_return_if_fail (mapping != NULL);
 
-  g_hash_table_insert (self->user_mappings, g_strdup (guid), g_strdup (mapping));
+  g_mutex_lock (&self->lock);
+
+  /* Store the full mapping string, like when reading the file */
+  g_hash_table_insert (self->user_mappings,
+                       g_strdup (guid),
+                       g_strdup_printf ("%s,%s,%s", guid, name, mapping));
   g_hash_table_insert (self->names, g_strdup (guid), g_strdup (name));
 
-  save_user_mappings (self, &error);
-  if (G_UNLIKELY (error != NULL))
-    g_critical ("ManetteMappingManager: Can’t save user mappings: %s", error->message);
+  write_now = request_save (self);
+
+  g_mutex_unlock (&self->lock);
+
+  if (write_now)
+    write_user_mappings (self);
+
+  g_signal_emit (self, signals[SIG_CHANGED], 0, guid);
 }
 
 void
 manette_mapping_manager_delete_mapping (ManetteMappingManager *self,
                                         const char            *guid)
 {
-  g_autoptr (GError) error = NULL;
+  gboolean write_now;
 
   g_return_if_fail (MANETTE_IS_MAPPING_MANAGER (self));
   g_return_if_fail (guid != NULL);
 
+  g_mutex_lock (&self->lock);
+
   g_hash_table_remove (self->user_mappings, guid);
   g_hash_table_remove (self->names, guid);
 
-  save_user_mappings (self, &error);
-  if (G_UNLIKELY (error != NULL))
-    g_critical ("ManetteMappingManager: Can’t save user mappings: %s", error->message);
+  write_now = request_save (self);
+
+  g_mutex_unlock (&self->lock);
+
+  if (write_now)
+    write_user_mappings (self);
+
+  g_signal_emit (self, signals[SIG_CHANGED], 0, guid);
 }
 
 GList *
 manette_mapping_manager_get_default_mappings (ManetteMappingManager *self)
 {
+  GList *mappings = NULL;
+  gsize i;
+
   g_return_val_if_fail (MANETTE_IS_MAPPING_MANAGER (self), NULL);
 
-  return g_hash_table_get_values (self->default_mappings);
+  /* The default mappings are never modified after construction, so the
+   * returned strings stay valid as long as @self is alive.
+   */
+  for (i = self->n_default_entries; i > 0; i--) {
+    const char *mapping = get_entry_mapping (self, &self->default_entries[i - 1]);
+
+    if (mapping != NULL)
+      mappings = g_list_prepend (mappings, (gpointer) mapping);
+  }
+
+  return mappings;
 }
 
 /* Type */
@@ -406,11 +784,19 @@ manette_mapping_manager_finalize (GObject *object)
 {
   ManetteMappingManager *self = MANETTE_MAPPING_MANAGER (object);
 
+  /* The pending sources hold a reference, so there can't be any left */
+  g_assert (self->save_source == NULL);
+  g_assert (self->reload_source == NULL);
+
+  g_clear_pointer (&self->context, g_main_context_unref);
+  g_clear_pointer (&self->etag, g_free);
   g_clear_pointer (&self->names, g_hash_table_unref);
-  g_clear_pointer (&self->default_mappings, g_hash_table_unref);
+  g_clear_pointer (&self->default_db, g_bytes_unref);
   g_clear_pointer (&self->user_mappings, g_hash_table_unref);
   g_clear_pointer (&self->user_mappings_uri, g_free);
   g_clear_object (&self->user_mappings_monitor);
+  g_mutex_clear (&self->lock);
+  g_mutex_clear (&self->write_lock);
 
   G_OBJECT_CLASS (manette_mapping_manager_parent_class)->finalize (object);
 }
@@ -423,16 +809,18 @@ manette_mapping_manager_class_init (ManetteMappingManagerClass *klass)
   /**
    * ManetteMappingManager::changed:
    * @self: a #ManetteMappingManager
+   * @guid: the GUID whose mapping changed
    *
-   * Emitted when some mappings changed.
+   * Emitted when the mapping for @guid changed.
    */
   signals[SIG_CHANGED] =
     g_signal_new ("changed",
                   MANETTE_TYPE_MAPPING_MANAGER,
                   G_SIGNAL_RUN_LAST,
                   0, NULL, NULL,
-                  g_cclosure_marshal_VOID__VOID,
-                  G_TYPE_NONE, 0);
+                  g_cclosure_marshal_VOID__STRING,
+                  G_TYPE_NONE, 1,
+                  G_TYPE_STRING);
 
   G_OBJECT_CLASS (klass)->finalize = manette_mapping_manager_finalize;
 }
@@ -440,4 +828,6 @@ manette_mapping_manager_class_init (ManetteMappingManagerClass *klass)
 static void
 manette_mapping_manager_init (ManetteMappingManager *self)
 {
+  g_mutex_init (&self->lock);
+  g_mutex_init (&self->write_lock);
 }
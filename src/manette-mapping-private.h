@@ -66,11 +66,40 @@ struct _ManetteMappingBinding {
   } destination;
 };
 
+/* A binding compiled for dispatching events: the source value is clamped to
+ * [min, max], then transformed into value * scale + offset. Button
+ * destinations are pressed when the transformed value is above threshold.
+ * The position is the one of the binding among all the mapping's.
+ */
+typedef struct {
+  ManetteMappingDestinationType type;
+  int code;
+  guint position;
+  double min;
+  double max;
+  double scale;
+  double offset;
+  double threshold;
+} ManetteMappingDispatchEntry;
+
 ManetteMapping *manette_mapping_new (const char  *mapping_string,
                                      GError     **error);
-const ManetteMappingBinding * const *manette_mapping_get_bindings (ManetteMapping          *self,
-                                                                   ManetteMappingInputType  type,
-                                                                   guint16                  index);
+ManetteMapping *manette_mapping_dup_for_string (const char  *mapping_string,
+                                                GError     **error);
+const ManetteMappingBinding *manette_mapping_get_bindings (ManetteMapping          *self,
+                                                           ManetteMappingInputType  type,
+                                                           guint16                  index,
+                                                           gsize                   *n_bindings);
+
+const ManetteMappingDispatchEntry *manette_mapping_get_dispatch (ManetteMapping          *self,
+                                                                 ManetteMappingInputType  type,
+                                                                 guint16                  index,
+                                                                 gsize                   *n_entries);
+
+const ManetteMappingDispatchEntry *manette_mapping_get_dispatch_entries (ManetteMapping *self,
+                                                                         gsize          *n_entries);
+
+gsize manette_mapping_get_max_bindings_per_input (ManetteMapping *self);
 
 ManetteMappingBinding *manette_mapping_binding_copy (ManetteMappingBinding *self);
 void manette_mapping_binding_free (ManetteMappingBinding *self);
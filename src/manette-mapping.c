@@ -20,20 +20,50 @@
 
 #include "manette-mapping-private.h"
 
-#include <errno.h>
-#include <stdlib.h>
 #include <string.h>
 
+#define N_INPUT_TYPES (MANETTE_MAPPING_INPUT_TYPE_HAT + 1)
+/* Enough for the bindings of most gamepads */
+#define N_PARSED_BINDINGS 32
+
+typedef struct {
+  guint start;
+  guint length;
+} BindingSlot;
+
 struct _ManetteMapping {
   GObject parent_instance;
 
-  GArray *axis_bindings;
-  GArray *button_bindings;
-  GArray *hat_bindings;
+  /* The bindings, their compiled dispatch entries and the slots locating the
+   * bindings of each input share a single allocation, in that order. A
+   * binding and its dispatch entry are at the same position. The slots of
+   * each input type follow each other, starting at slots_start[type].
+   */
+  gpointer tables;
+  ManetteMappingDispatchEntry *dispatch_entries;
+  ManetteMappingBinding *bindings;
+  BindingSlot *slots;
+  guint n_bindings;
+  guint slots_start[N_INPUT_TYPES];
+  guint n_slots[N_INPUT_TYPES];
+  guint max_slot_length;
+
+  /* The string it's shared for, see manette_mapping_dup_for_string() */
+  char *cache_key;
 };
 
 G_DEFINE_FINAL_TYPE (ManetteMapping, manette_mapping, G_TYPE_OBJECT)
 
+/* So the tables can follow each other without padding */
+G_STATIC_ASSERT (G_ALIGNOF (ManetteMappingBinding) <= G_ALIGNOF (ManetteMappingDispatchEntry));
+G_STATIC_ASSERT (G_ALIGNOF (BindingSlot) <= G_ALIGNOF (ManetteMappingBinding));
+
+/* Associates mapping strings with weak references to the mappings shared for
+ * them, mappings are immutable so they can be shared by any device.
+ */
+G_LOCK_DEFINE_STATIC (mapping_cache);
+static GHashTable *mapping_cache;
+
 G_DEFINE_BOXED_TYPE (ManetteMappingBinding, manette_mapping_binding, manette_mapping_binding_copy, manette_mapping_binding_free)
 
 #ifdef G_DISABLE_CHECKS
@@ -59,14 +89,42 @@ G_DEFINE_BOXED_TYPE (ManetteMappingBinding, manette_mapping_binding, manette_map
 
 /* Private */
 
+static void
+weak_ref_free (GWeakRef *weak_ref)
+{
+  g_weak_ref_clear (weak_ref);
+  g_free (weak_ref);
+}
+
+static void
+uncache (ManetteMapping *self)
+{
+  g_autoptr (ManetteMapping) replacement = NULL;
+  GWeakRef *weak_ref;
+
+  G_LOCK (mapping_cache);
+
+  /* Another thread may have replaced us while we were being finalized */
+  weak_ref = g_hash_table_lookup (mapping_cache, self->cache_key);
+  if (weak_ref != NULL)
+    replacement = g_weak_ref_get (weak_ref);
+  if (weak_ref != NULL && replacement == NULL)
+    g_hash_table_remove (mapping_cache, self->cache_key);
+
+  G_UNLOCK (mapping_cache);
+}
+
 static void
 manette_mapping_finalize (GObject *object)
 {
   ManetteMapping *self = (ManetteMapping *)object;
 
-  g_clear_pointer (&self->axis_bindings, g_array_unref);
-  g_clear_pointer (&self->button_bindings, g_array_unref);
-  g_clear_pointer (&self->hat_bindings, g_array_unref);
+  if (self->cache_key != NULL) {
+    uncache (self);
+    g_clear_pointer (&self->cache_key, g_free);
+  }
+
+  g_clear_pointer (&self->tables, g_free);
 
   G_OBJECT_CLASS (manette_mapping_parent_class)->finalize (object);
 }
@@ -85,72 +143,60 @@ manette_mapping_init (ManetteMapping *self)
 }
 
 static gboolean
-bindings_array_has_destination_input (GArray                        *array,
-                                      ManetteMappingDestinationType  type,
-                                      guint                          code)
-{
-  gsize i;
-  gsize j;
-  GArray *sub_array;
-  ManetteMappingBinding *binding;
-
-  for (i = 0; i < array->len; i++) {
-    sub_array = g_array_index (array, GArray *, i);
-    if (sub_array == NULL)
-      continue;
+parse_mapping_number (const char  *start,
+                      const char  *end,
+                      const char **next,
+                      guint16     *result)
+{
+  const char *cursor;
+  guint value = 0;
 
-    for (j = 0; j < sub_array->len; j++) {
-      binding = g_array_index (sub_array, ManetteMappingBinding *, j);
-      if (binding == NULL)
-        continue;
+  manette_ensure_is_parseable (start);
+  manette_ensure_is_parseable (next);
+  manette_ensure_is_parseable (result);
 
-      if (binding->destination.type == type &&
-          binding->destination.code == code)
-        return TRUE;
-    }
+  for (cursor = start; cursor < end && g_ascii_isdigit (*cursor); cursor++) {
+    value = value * 10 + g_ascii_digit_value (*cursor);
+    if (value > G_MAXUINT16)
+      return FALSE;
   }
 
-  return FALSE;
-}
-
-static gboolean
-try_str_to_guint16 (char     *start,
-                    char    **end,
-                    guint16  *result)
-{
-  manette_ensure_is_parseable (start);
-  manette_ensure_is_parseable (end);
-  manette_ensure_is_parseable (result);
+  if (cursor == start)
+    return FALSE;
 
-  errno = 0;
-  *result = strtol (start, end, 10);
+  *result = value;
+  *next = cursor;
 
-  return errno == 0;
+  return TRUE;
 }
 
 static gboolean
-parse_mapping_input_type (char                     *start,
-                          char                    **end,
+parse_mapping_input_type (const char               *start,
+                          const char               *end,
+                          const char              **next,
                           ManetteMappingInputType  *input_type)
 {
   manette_ensure_is_parseable (start);
-  manette_ensure_is_parseable (end);
+  manette_ensure_is_parseable (next);
   manette_ensure_is_parseable (input_type);
 
+  if (start == end)
+    return FALSE;
+
   switch (*start) {
   case 'a':
     *input_type = MANETTE_MAPPING_INPUT_TYPE_AXIS;
-    *end = start + 1;
+    *next = start + 1;
 
     return TRUE;
   case 'b':
     *input_type = MANETTE_MAPPING_INPUT_TYPE_BUTTON;
-    *end = start + 1;
+    *next = start + 1;
 
     return TRUE;
   case 'h':
     *input_type = MANETTE_MAPPING_INPUT_TYPE_HAT;
-    *end = start + 1;
+    *next = start + 1;
 
     return TRUE;
   default:
@@ -159,66 +205,77 @@ parse_mapping_input_type (char                     *start,
 }
 
 static gboolean
-parse_mapping_index (char     *start,
-                     char    **end,
-                     guint16  *index)
+parse_mapping_index (const char  *start,
+                     const char  *end,
+                     const char **next,
+                     guint16     *index)
 {
-  return try_str_to_guint16 (start, end, index);
+  return parse_mapping_number (start, end, next, index);
 }
 
 static gboolean
-parse_mapping_invert (char      *start,
-                      char     **end,
-                      gboolean  *invert)
+parse_mapping_invert (const char  *start,
+                      const char  *end,
+                      const char **next,
+                      gboolean    *invert)
 {
   manette_ensure_is_parseable (start);
-  manette_ensure_is_parseable (end);
+  manette_ensure_is_parseable (next);
   manette_ensure_is_parseable (invert);
 
-  switch (*start) {
-  case '~':
+  if (start < end && *start == '~') {
     *invert = TRUE;
-    *end = start + 1;
-
-    return TRUE;
-  default:
-    *invert = FALSE;
+    *next = start + 1;
 
     return TRUE;
   }
+
+  *invert = FALSE;
+  *next = start;
+
+  return TRUE;
 }
 
 static gboolean
-parse_mapping_range (char                 *start,
-                     char                **end,
+parse_mapping_range (const char           *start,
+                     const char           *end,
+                     const char          **next,
                      ManetteMappingRange  *range)
 {
   manette_ensure_is_parseable (start);
-  manette_ensure_is_parseable (end);
+  manette_ensure_is_parseable (next);
   manette_ensure_is_parseable (range);
 
+  if (start == end) {
+    *range = MANETTE_MAPPING_RANGE_FULL;
+    *next = start;
+
+    return TRUE;
+  }
+
   switch (*start) {
   case '+':
     *range = MANETTE_MAPPING_RANGE_POSITIVE;
-    *end = start + 1;
+    *next = start + 1;
 
     return TRUE;
   case '-':
     *range = MANETTE_MAPPING_RANGE_NEGATIVE;
-    *end = start + 1;
+    *next = start + 1;
 
     return TRUE;
   default:
     *range = MANETTE_MAPPING_RANGE_FULL;
-    *end = start;
+    *next = start;
 
     return TRUE;
   }
 }
 
 static gboolean
-parse_mapping_hat (char                 *start,
-                   char                **end,
+parse_mapping_hat (const char           *start,
+                   const char           *end,
+                   const char          **next,
                    guint16              *index,
                    ManetteMappingRange  *range,
                    gboolean             *invert)
@@ -228,22 +285,20 @@ parse_mapping_hat (char                 *start,
   guint16 hat_position = 0;
 
   manette_ensure_is_parseable (start);
-  manette_ensure_is_parseable (end);
+  manette_ensure_is_parseable (next);
   manette_ensure_is_parseable (index);
   manette_ensure_is_parseable (range);
   manette_ensure_is_parseable (invert);
 
-  if (!try_str_to_guint16 (start, end, &hat_index))
+  if (!parse_mapping_number (start, end, &start, &hat_index))
     return FALSE;
 
-  start = *end;
-
-  if (start == NULL || *start != '.')
+  if (start == end || *start != '.')
     return FALSE;
 
   start++;
 
-  if (!try_str_to_guint16 (start, end, &hat_position_2pow))
+  if (!parse_mapping_number (start, end, next, &hat_position_2pow))
     return FALSE;
 
   /* hat_position: 0 up, 1 right, 2 down, 3 left. */
@@ -265,9 +320,20 @@ parse_mapping_hat (char                 *start,
   return TRUE;
 }
 
+static inline gboolean
+token_equal (const char *start,
+             const char *end,
+             const char *string)
+{
+  gsize length = strlen (string);
+
+  return (gsize) (end - start) == length && memcmp (start, string, length) == 0;
+}
+
 static gboolean
-parse_destination_input (char                           *start,
-                         char                          **end,
+parse_destination_input (const char                     *start,
+                         const char                     *end,
+                         const char                    **next,
                          ManetteMappingDestinationType  *type,
                          int                            *code)
 {
@@ -318,20 +384,20 @@ parse_destination_input (char                           *start,
   int i;
 
   for (i = 0; i < G_N_ELEMENTS (axis_values); i++) {
-    if (g_strcmp0 (start, axis_values[i].string_value) == 0) {
+    if (token_equal (start, end, axis_values[i].string_value)) {
       *type = MANETTE_MAPPING_DESTINATION_TYPE_AXIS;
       *code = axis_values[i].axis;
-      *end = start + strlen (axis_values[i].string_value);
+      *next = end;
 
       return TRUE;
     }
   }
 
   for (i = 0; i < G_N_ELEMENTS (button_values); i++) {
-    if (g_strcmp0 (start, button_values[i].string_value) == 0) {
+    if (token_equal (start, end, button_values[i].string_value)) {
       *type = MANETTE_MAPPING_DESTINATION_TYPE_BUTTON;
       *code = button_values[i].button;
-      *end = start + strlen (button_values[i].string_value);
+      *next = end;
 
       return TRUE;
     }
@@ -340,46 +406,19 @@ parse_destination_input (char                           *start,
   return FALSE;
 }
 
-static void
-manette_mapping_binding_try_free (ManetteMappingBinding **binding)
-{
-  if (G_LIKELY (binding))
-    g_clear_pointer (binding, manette_mapping_binding_free);
-}
-
-static void
-append_binding (GArray                *type_array,
-                ManetteMappingBinding *binding)
-{
-  GArray *binding_array;
-  ManetteMappingBinding *binding_copy;
-  guint16 index = binding->source.index;
-
-  if (type_array->len <= index)
-    g_array_set_size (type_array, index + 1);
-
-  if (g_array_index (type_array, GArray *, index) == NULL) {
-    binding_array = g_array_new (TRUE, TRUE, sizeof (ManetteMappingBinding *));
-    g_array_set_clear_func (binding_array, (GDestroyNotify) manette_mapping_binding_try_free);
-    g_array_index (type_array, GArray *, index) = binding_array;
-  }
-  else
-    binding_array = g_array_index (type_array, GArray *, index);
-
-  binding_copy = manette_mapping_binding_copy (binding);
-  g_array_append_val (binding_array, binding_copy);
-}
-
 static gboolean
-parse_mapping_destination (char                  *destination,
+parse_mapping_destination (const char            *destination,
+                           const char            *end,
                            ManetteMappingBinding *binding)
 {
   if (!parse_mapping_range (destination,
+                            end,
                             &destination,
                             &binding->destination.range))
     return FALSE;
 
   if (!parse_destination_input (destination,
+                                end,
                                 &destination,
                                 &binding->destination.type,
                                 &binding->destination.code))
@@ -392,22 +431,25 @@ parse_mapping_destination (char                  *destination,
     binding->destination.range = MANETTE_MAPPING_RANGE_POSITIVE;
   }
 
-  if (*destination != '\0')
+  if (destination != end)
     return FALSE;
 
   return TRUE;
 }
 
 static gboolean
-parse_mapping_source (char                  *source,
+parse_mapping_source (const char            *source,
+                      const char            *end,
                       ManetteMappingBinding *binding)
 {
   if (!parse_mapping_range (source,
+                            end,
                             &source,
                             &binding->source.range))
     return FALSE;
 
   if (!parse_mapping_input_type (source,
+                                 end,
                                  &source,
                                  &binding->source.type))
     return FALSE;
@@ -415,11 +457,13 @@ parse_mapping_source (char                  *source,
   switch (binding->source.type) {
   case MANETTE_MAPPING_INPUT_TYPE_AXIS:
     if (!parse_mapping_index (source,
+                              end,
                               &source,
                               &binding->source.index))
       return FALSE;
 
     if (!parse_mapping_invert (source,
+                               end,
                                &source,
                                &binding->source.invert))
       return FALSE;
@@ -430,6 +474,7 @@ parse_mapping_source (char                  *source,
       return FALSE;
 
     if (!parse_mapping_index (source,
+                              end,
                               &source,
                               &binding->source.index))
       return FALSE;
@@ -442,6 +487,7 @@ parse_mapping_source (char                  *source,
       return FALSE;
 
     if (!parse_mapping_hat (source,
+                            end,
                             &source,
                             &binding->source.index,
                             &binding->source.range,
@@ -453,41 +499,81 @@ parse_mapping_source (char                  *source,
     return FALSE;
   }
 
-  if (*source != '\0')
+  if (source != end)
     return FALSE;
 
   return TRUE;
 }
 
 static gboolean
-is_valid_guid (const char *string)
+is_valid_guid (const char *start,
+               const char *end)
 {
-  if (!string)
+  if (end - start < 32)
     return FALSE;
 
   for (guint i = 0; i < 32; i++)
-    if (!g_ascii_isxdigit (string[i]))
+    if (!g_ascii_isxdigit (start[i]))
       return FALSE;
 
   return TRUE;
 }
 
-/* This function doesn't take care of cleaning up the object's state before
- * setting it.
+/* A comma separated field of a mapping string, pointing into the string
+ * rather than copying it. For key:value fields, separator points to the
+ * first colon.
+ */
+typedef struct {
+  const char *start;
+  const char *separator;
+  const char *end;
+  guint n_separators;
+} MappingField;
+
+/* Reads the field at *cursor and moves *cursor past it, *cursor is NULL once
+ * the whole string has been read.
+ */
+static gboolean
+next_field (const char   **cursor,
+            MappingField  *field)
+{
+  const char *c = *cursor;
+
+  if (c == NULL)
+    return FALSE;
+
+  field->start = c;
+  field->separator = NULL;
+  field->n_separators = 0;
+
+  for (; *c != ',' && *c != '\0'; c++) {
+    if (*c != ':')
+      continue;
+
+    if (field->separator == NULL)
+      field->separator = c;
+    field->n_separators++;
+  }
+
+  field->end = c;
+  *cursor = *c == ',' ? c + 1 : NULL;
+
+  return TRUE;
+}
+
+/* Appends the bindings of the mapping string to bindings, in the order they
+ * appear in it.
  */
 static void
-set_from_mapping_string (ManetteMapping  *self,
-                         const char      *mapping_string,
-                         GError         **error)
-{
-  g_auto(GStrv) mappings = g_strsplit (mapping_string, ",", 0);
-  guint mappings_length = g_strv_length (mappings);
-  guint i = 0;
-  char *destination_string;
-  char *source_string;
+parse_mapping_string (const char  *mapping_string,
+                      GArray      *bindings,
+                      GError     **error)
+{
+  const char *cursor = mapping_string;
+  MappingField guid, name, field;
   ManetteMappingBinding binding = {};
 
-  if (mappings_length < 2) {
+  if (!next_field (&cursor, &guid) || !next_field (&cursor, &name)) {
     g_set_error (error,
                  MANETTE_MAPPING_ERROR,
                  MANETTE_MAPPING_ERROR_NOT_A_MAPPING,
@@ -497,7 +583,7 @@ set_from_mapping_string (ManetteMapping  *self,
     return;
   }
 
-  if (!is_valid_guid (mappings[0])) {
+  if (!is_valid_guid (guid.start, guid.end)) {
     g_set_error (error,
                  MANETTE_MAPPING_ERROR,
                  MANETTE_MAPPING_ERROR_NOT_A_MAPPING,
@@ -507,55 +593,209 @@ set_from_mapping_string (ManetteMapping  *self,
     return;
   }
 
-  for (i = 2; i < mappings_length; i++) {
-    g_auto(GStrv) splitted_mapping = g_strsplit (mappings[i], ":", 0);
+  while (next_field (&cursor, &field)) {
+    const char *destination_string = field.start;
+    const char *source_string;
 
-    if (g_strv_length (splitted_mapping) != 2)
+    if (field.n_separators != 1)
       continue;
 
-    destination_string = splitted_mapping[0];
-    source_string = splitted_mapping[1];
+    source_string = field.separator + 1;
 
     /* Skip the platform key. */
-    if (g_strcmp0 ("platform", splitted_mapping[0]) == 0)
+    if (token_equal (field.start, field.separator, "platform"))
       continue;
 
-    if (!parse_mapping_destination (destination_string, &binding)) {
-      g_critical ("Invalid binding destination: %s:%s in %s", destination_string, source_string, mapping_string);
+    if (!parse_mapping_destination (destination_string, field.separator, &binding)) {
+      g_critical ("Invalid binding destination: %.*s in %s",
+                  (int) (field.end - field.start), field.start, mapping_string);
 
       continue;
     }
 
-    if (!parse_mapping_source (source_string, &binding)) {
-      g_critical ("Invalid binding source: %s:%s in %s", destination_string, source_string, mapping_string);
+    if (!parse_mapping_source (source_string, field.end, &binding)) {
+      g_critical ("Invalid binding source: %.*s in %s",
+                  (int) (field.end - field.start), field.start, mapping_string);
 
       continue;
     }
 
-    switch (binding.source.type) {
-    case MANETTE_MAPPING_INPUT_TYPE_AXIS:
-      append_binding (self->axis_bindings, &binding);
-
-      break;
-    case MANETTE_MAPPING_INPUT_TYPE_BUTTON:
-      append_binding (self->button_bindings, &binding);
+    g_array_append_val (bindings, binding);
+  }
+}
 
+static void
+compile_axis_binding (const ManetteMappingBinding *binding,
+                      ManetteMappingDispatchEntry *entry)
+{
+  double invert = binding->source.invert ? -1 : 1;
+
+  if (binding->source.range == MANETTE_MAPPING_RANGE_NEGATIVE)
+    entry->max = 0;
+  if (binding->source.range == MANETTE_MAPPING_RANGE_POSITIVE)
+    entry->min = 0;
+
+  switch (binding->destination.type) {
+  case MANETTE_MAPPING_DESTINATION_TYPE_AXIS:
+    switch (binding->destination.range) {
+    case MANETTE_MAPPING_RANGE_NEGATIVE:
+      entry->scale = invert / 2;
+      entry->offset = -0.5;
       break;
-    case MANETTE_MAPPING_INPUT_TYPE_HAT:
-      append_binding (self->hat_bindings, &binding);
-
+    case MANETTE_MAPPING_RANGE_POSITIVE:
+      entry->scale = invert / 2;
+      entry->offset = 0.5;
       break;
+    case MANETTE_MAPPING_RANGE_FULL:
     default:
-      g_assert_not_reached ();
+      entry->scale = invert;
+      break;
+    }
+
+    break;
+  case MANETTE_MAPPING_DESTINATION_TYPE_BUTTON:
+    /* A full range is pressed past the center, a half range is pressed past
+     * its middle, which is where its absolute value crosses 0.5.
+     */
+    if (binding->source.range == MANETTE_MAPPING_RANGE_FULL) {
+      entry->scale = invert;
+    } else {
+      double sign = binding->source.range == MANETTE_MAPPING_RANGE_NEGATIVE ? -1 : 1;
+
+      entry->scale = sign * invert;
+      entry->threshold = invert / 2;
     }
+
+    break;
+  default:
+    g_assert_not_reached ();
+  }
+}
+
+static void
+compile_button_binding (const ManetteMappingBinding *binding,
+                        ManetteMappingDispatchEntry *entry)
+{
+  switch (binding->destination.type) {
+  case MANETTE_MAPPING_DESTINATION_TYPE_AXIS:
+    entry->scale = binding->destination.range == MANETTE_MAPPING_RANGE_NEGATIVE ? -1 : 1;
+
+    break;
+  case MANETTE_MAPPING_DESTINATION_TYPE_BUTTON:
+    entry->threshold = 0.5;
+
+    break;
+  default:
+    g_assert_not_reached ();
+  }
+}
+
+static void
+compile_hat_binding (const ManetteMappingBinding *binding,
+                     ManetteMappingDispatchEntry *entry)
+{
+  /* Hat bindings are always half ranges, the value is their absolute value.
+   * Axis destinations ignore values out of [min, max] rather than clamping
+   * them, see manette_map_hat_event().
+   */
+  if (binding->source.range == MANETTE_MAPPING_RANGE_NEGATIVE) {
+    entry->max = 0;
+    entry->scale = -1;
+  } else {
+    entry->min = 0;
+  }
+}
+
+static void
+compile_dispatch_entry (const ManetteMappingBinding *binding,
+                        ManetteMappingDispatchEntry *entry)
+{
+  entry->type = binding->destination.type;
+  entry->code = binding->destination.code;
+  entry->min = -G_MAXDOUBLE;
+  entry->max = G_MAXDOUBLE;
+  entry->scale = 1;
+
+  switch (binding->source.type) {
+  case MANETTE_MAPPING_INPUT_TYPE_AXIS:
+    compile_axis_binding (binding, entry);
+    break;
+  case MANETTE_MAPPING_INPUT_TYPE_BUTTON:
+    compile_button_binding (binding, entry);
+    break;
+  case MANETTE_MAPPING_INPUT_TYPE_HAT:
+    compile_hat_binding (binding, entry);
+    break;
+  default:
+    g_assert_not_reached ();
   }
 }
 
+static inline BindingSlot *
+get_slot (ManetteMapping          *self,
+          ManetteMappingInputType  type,
+          guint16                  index)
+{
+  return &self->slots[self->slots_start[type] + index];
+}
+
+/* Packs the bindings by input, keeping the order they appear in the mapping
+ * string, and compiles them.
+ */
 static void
-g_array_try_free (GArray **array)
+compile_tables (ManetteMapping *self,
+                GArray         *bindings)
 {
-  if (G_LIKELY (array))
-    g_clear_pointer (array, g_array_unref);
+  gsize entries_size, bindings_size, slots_size;
+  guint n_slots = 0;
+  guint start = 0;
+  guint type, i;
+
+  for (i = 0; i < bindings->len; i++) {
+    const ManetteMappingBinding *binding = &g_array_index (bindings, ManetteMappingBinding, i);
+
+    type = binding->source.type;
+    self->n_slots[type] = MAX (self->n_slots[type], binding->source.index + 1u);
+  }
+
+  for (type = 0; type < N_INPUT_TYPES; type++) {
+    self->slots_start[type] = n_slots;
+    n_slots += self->n_slots[type];
+  }
+
+  self->n_bindings = bindings->len;
+  entries_size = sizeof (ManetteMappingDispatchEntry) * bindings->len;
+  bindings_size = sizeof (ManetteMappingBinding) * bindings->len;
+  slots_size = sizeof (BindingSlot) * n_slots;
+
+  self->tables = g_malloc0 (entries_size + bindings_size + slots_size);
+  self->dispatch_entries = self->tables;
+  self->bindings = (ManetteMappingBinding *) ((guint8 *) self->tables + entries_size);
+  self->slots = (BindingSlot *) ((guint8 *) self->tables + entries_size + bindings_size);
+
+  /* Count the bindings of each input to know where its range starts */
+  for (i = 0; i < bindings->len; i++) {
+    const ManetteMappingBinding *binding = &g_array_index (bindings, ManetteMappingBinding, i);
+
+    get_slot (self, binding->source.type, binding->source.index)->length++;
+  }
+
+  for (i = 0; i < n_slots; i++) {
+    self->slots[i].start = start;
+    start += self->slots[i].length;
+    self->max_slot_length = MAX (self->max_slot_length, self->slots[i].length);
+    self->slots[i].length = 0;
+  }
+
+  for (i = 0; i < bindings->len; i++) {
+    const ManetteMappingBinding *binding = &g_array_index (bindings, ManetteMappingBinding, i);
+    BindingSlot *slot = get_slot (self, binding->source.type, binding->source.index);
+    guint position = slot->start + slot->length++;
+
+    self->bindings[position] = *binding;
+    compile_dispatch_entry (binding, &self->dispatch_entries[position]);
+    self->dispatch_entries[position].position = position;
+  }
 }
 
 static gboolean
@@ -563,14 +803,12 @@ has_destination_input (ManetteMapping                *self,
                        ManetteMappingDestinationType  type,
                        int                            code)
 {
-  if (bindings_array_has_destination_input (self->axis_bindings, type, code))
-    return TRUE;
-
-  if (bindings_array_has_destination_input (self->button_bindings, type, code))
-    return TRUE;
+  guint i;
 
-  if (bindings_array_has_destination_input (self->hat_bindings, type, code))
-    return TRUE;
+  for (i = 0; i < self->n_bindings; i++)
+    if (self->bindings[i].destination.type == type &&
+        self->bindings[i].destination.code == code)
+      return TRUE;
 
   return FALSE;
 }
@@ -579,7 +817,8 @@ ManetteMapping *
 manette_mapping_new (const char   *mapping_string,
                      GError      **error)
 {
-  g_autoptr (ManetteMapping) self = NULL;
+  ManetteMapping *self;
+  g_autoptr (GArray) bindings = NULL;
   GError *inner_error = NULL;
 
   if (mapping_string == NULL) {
@@ -600,63 +839,193 @@ manette_mapping_new (const char   *mapping_string,
     return NULL;
   }
 
-  self = (ManetteMapping*) g_object_new (MANETTE_TYPE_MAPPING, NULL);
-
-  self->axis_bindings = g_array_new (FALSE, TRUE, sizeof (GArray *));
-  g_array_set_clear_func (self->axis_bindings, (GDestroyNotify) g_array_try_free);
-  self->button_bindings = g_array_new (FALSE, TRUE, sizeof (GArray *));
-  g_array_set_clear_func (self->button_bindings, (GDestroyNotify) g_array_try_free);
-  self->hat_bindings = g_array_new (FALSE, TRUE, sizeof (GArray *));
-  g_array_set_clear_func (self->hat_bindings, (GDestroyNotify) g_array_try_free);
+  bindings = g_array_sized_new (FALSE, FALSE, sizeof (ManetteMappingBinding), N_PARSED_BINDINGS);
 
-  set_from_mapping_string (self, mapping_string, &inner_error);
+  parse_mapping_string (mapping_string, bindings, &inner_error);
   if (G_UNLIKELY (inner_error != NULL)) {
     g_propagate_error (error, inner_error);
 
     return NULL;
   }
 
-  return g_steal_pointer (&self);
+  self = (ManetteMapping*) g_object_new (MANETTE_TYPE_MAPPING, NULL);
+
+  compile_tables (self, bindings);
+
+  return self;
 }
 
-const ManetteMappingBinding * const *
-manette_mapping_get_bindings (ManetteMapping          *self,
-                              ManetteMappingInputType  type,
-                              guint16                  index)
+/**
+ * manette_mapping_dup_for_string:
+ * @mapping_string: a mapping string
+ * @error: return location for a #GError, or %NULL
+ *
+ * Gets the mapping shared for @mapping_string, parsing it only if no such
+ * mapping is alive, so identical devices share a single mapping.
+ *
+ * This function is thread-safe.
+ *
+ * Returns: (transfer full) (nullable): the shared mapping
+ */
+ManetteMapping *
+manette_mapping_dup_for_string (const char  *mapping_string,
+                                GError     **error)
 {
-  GArray *type_array;
-  GArray *bindings_array;
+  ManetteMapping *self, *cached;
+  GWeakRef *weak_ref;
 
-  switch (type)
-  {
-  case MANETTE_MAPPING_INPUT_TYPE_AXIS:
-    type_array = self->axis_bindings;
+  if (mapping_string == NULL)
+    return manette_mapping_new (mapping_string, error);
 
-    break;
-  case MANETTE_MAPPING_INPUT_TYPE_BUTTON:
-    type_array = self->button_bindings;
+  G_LOCK (mapping_cache);
 
-    break;
-  case MANETTE_MAPPING_INPUT_TYPE_HAT:
-    type_array = self->hat_bindings;
+  if (mapping_cache == NULL)
+    mapping_cache = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                           g_free, (GDestroyNotify) weak_ref_free);
 
-    break;
-  default:
+  weak_ref = g_hash_table_lookup (mapping_cache, mapping_string);
+  cached = weak_ref ? g_weak_ref_get (weak_ref) : NULL;
+
+  G_UNLOCK (mapping_cache);
+
+  if (cached != NULL)
+    return cached;
+
+  /* Parse without the lock so other devices aren't held up by it */
+  self = manette_mapping_new (mapping_string, error);
+  if (self == NULL)
     return NULL;
+
+  G_LOCK (mapping_cache);
+
+  /* Another thread may have cached the same mapping in the meantime, in which
+   * case our copy is dropped. It isn't cached yet, so it won't uncache theirs.
+   */
+  weak_ref = g_hash_table_lookup (mapping_cache, mapping_string);
+  cached = weak_ref ? g_weak_ref_get (weak_ref) : NULL;
+  if (cached != NULL) {
+    G_UNLOCK (mapping_cache);
+    g_object_unref (self);
+
+    return cached;
   }
 
-  if (type_array == NULL)
-    return NULL;
+  self->cache_key = g_strdup (mapping_string);
+
+  if (weak_ref == NULL) {
+    weak_ref = g_new0 (GWeakRef, 1);
+    g_weak_ref_init (weak_ref, self);
+    g_hash_table_insert (mapping_cache, g_strdup (mapping_string), weak_ref);
+  } else {
+    g_weak_ref_set (weak_ref, self);
+  }
+
+  G_UNLOCK (mapping_cache);
+
+  return self;
+}
+
+/**
+ * manette_mapping_get_bindings:
+ * @self: a mapping
+ * @type: the type of the input
+ * @index: the index of the input
+ * @n_bindings: (out): return location for the number of bindings
+ *
+ * Gets the bindings of the given input, in the order they appear in the
+ * mapping string.
+ *
+ * Returns: (nullable): the bindings of the input
+ */
+const ManetteMappingBinding *
+manette_mapping_get_bindings (ManetteMapping          *self,
+                              ManetteMappingInputType  type,
+                              guint16                  index,
+                              gsize                   *n_bindings)
+{
+  const BindingSlot *slot;
+
+  g_assert (n_bindings != NULL);
+
+  if (G_UNLIKELY (type >= N_INPUT_TYPES || index >= self->n_slots[type])) {
+    *n_bindings = 0;
 
-  if (index >= type_array->len)
     return NULL;
+  }
+
+  slot = get_slot (self, type, index);
+  *n_bindings = slot->length;
+
+  return &self->bindings[slot->start];
+}
+
+/**
+ * manette_mapping_get_dispatch:
+ * @self: a mapping
+ * @type: the type of the input
+ * @index: the index of the input
+ * @n_entries: (out): return location for the number of entries
+ *
+ * Gets the compiled bindings of the given input, in the order they appear in
+ * the mapping string.
+ *
+ * Returns: (nullable): the dispatch entries of the input
+ */
+const ManetteMappingDispatchEntry *
+manette_mapping_get_dispatch (ManetteMapping          *self,
+                              ManetteMappingInputType  type,
+                              guint16                  index,
+                              gsize                   *n_entries)
+{
+  const BindingSlot *slot;
 
-  bindings_array = g_array_index (type_array, GArray *, index);
+  g_assert (n_entries != NULL);
+
+  if (G_UNLIKELY (type >= N_INPUT_TYPES || index >= self->n_slots[type])) {
+    *n_entries = 0;
 
-  if (bindings_array == NULL)
     return NULL;
+  }
+
+  slot = get_slot (self, type, index);
+  *n_entries = slot->length;
+
+  return &self->dispatch_entries[slot->start];
+}
+
+/**
+ * manette_mapping_get_dispatch_entries:
+ * @self: a mapping
+ * @n_entries: (out): return location for the number of entries
+ *
+ * Gets the compiled bindings of every input, indexed by their position.
+ *
+ * Returns: (nullable): the dispatch entries of the mapping
+ */
+const ManetteMappingDispatchEntry *
+manette_mapping_get_dispatch_entries (ManetteMapping *self,
+                                      gsize          *n_entries)
+{
+  g_assert (n_entries != NULL);
+
+  *n_entries = self->n_bindings;
+
+  return self->dispatch_entries;
+}
 
-  return (const ManetteMappingBinding * const *) bindings_array->data;
+/**
+ * manette_mapping_get_max_bindings_per_input:
+ * @self: a mapping
+ *
+ * Gets the largest number of bindings of a single input, which is how many
+ * events mapping an event can produce at most.
+ *
+ * Returns: the largest number of bindings of an input
+ */
+gsize
+manette_mapping_get_max_bindings_per_input (ManetteMapping *self)
+{
+  return self->max_slot_length;
 }
 
 ManetteMappingBinding *
@@ -0,0 +1,36 @@
+/* manette-monitor-private.h
+ *
+ * Copyright (C) 2026 The libmanette authors
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#if !defined(MANETTE_COMPILATION)
+# error "This file is private, only <libmanette.h> can be included directly."
+#endif
+
+#include "manette-monitor.h"
+#include "manette-backend-private.h"
+
+G_BEGIN_DECLS
+
+void manette_monitor_add_backend (ManetteMonitor *self,
+                                  const char     *filename,
+                                  ManetteBackend *backend);
+void manette_monitor_remove_device (ManetteMonitor *self,
+                                    const char     *filename);
+
+G_END_DECLS
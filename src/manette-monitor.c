@@ -18,7 +18,7 @@
 
 #include "config.h"
 
-#include "manette-monitor.h"
+#include "manette-monitor-private.h"
 
 #include <glib.h>
 #include <glib-object.h>
@@ -29,8 +29,10 @@
 
 #include "manette-backend-private.h"
 #include "manette-device-private.h"
+#include "manette-event-queue-private.h"
 #include "manette-evdev-backend-private.h"
 #include "manette-hid-backend-private.h"
+#include "manette-input-thread-private.h"
 #include "manette-mapping-manager-private.h"
 
 #define DEV_DIRECTORY "/dev"
@@ -41,6 +43,11 @@
  *
  * An object monitoring the availability of devices.
  *
+ * The devices are initialized in the background, including the ones already
+ * present when the monitor is created. [signal@Monitor::device-connected] is
+ * emitted on the thread-default main context the monitor was created on as
+ * each of them becomes ready.
+ *
  * See also: [class@Device].
  */
 
@@ -55,10 +62,34 @@ struct _ManetteMonitor {
   GFileMonitor *dev_monitor;
   GFileMonitor *input_monitor;
   GHashTable *potential_devices;
+
+  gboolean use_input_thread;
+  ManetteInputThread *input_thread;
+
+  /* The devices being initialized, by filename, including the cancelled ones
+   * until their initialization is over
+   */
+  GHashTable *probes;
+
+  /* The events buffered for manette_monitor_poll_events() */
+  GMainContext *context;
+  guint event_queue_size;
+  ManetteEventOverflow event_queue_overflow;
+  ManetteEventQueue *event_queue;
 };
 
 G_DEFINE_FINAL_TYPE (ManetteMonitor, manette_monitor, G_TYPE_OBJECT)
 
+enum {
+  PROP_0,
+  PROP_USE_INPUT_THREAD,
+  PROP_EVENT_QUEUE_SIZE,
+  PROP_EVENT_QUEUE_OVERFLOW,
+  N_PROPS,
+};
+
+static GParamSpec *props[N_PROPS];
+
 enum {
   SIG_DEVICE_CONNECTED,
   SIG_DEVICE_DISCONNECTED,
@@ -89,7 +120,7 @@ load_mapping (ManetteMonitor *self,
   guid = manette_device_get_guid (device);
   mapping_string = manette_mapping_manager_get_mapping (self->mapping_manager,
                                                         guid);
-  mapping = manette_mapping_new (mapping_string, &error);
+  mapping = manette_mapping_dup_for_string (mapping_string, &error);
   if (G_UNLIKELY (error != NULL)) {
     g_debug ("%s", error->message);
 
@@ -99,30 +130,65 @@ load_mapping (ManetteMonitor *self,
   manette_device_set_mapping (device, mapping);
 }
 
-static void
-add_device (ManetteMonitor *self,
-            const char     *filename,
-            gboolean        is_hid)
+typedef struct {
+  GWeakRef monitor;
+  char *filename;
+  GCancellable *cancellable;
+  /* The backend of the device plugged back in while the cancelled
+   * initialization was still running
+   */
+  ManetteBackend *next_backend;
+} ProbeData;
+
+static ProbeData *
+probe_data_new (ManetteMonitor *monitor,
+                const char     *filename)
 {
-  g_autoptr (ManetteDevice) device = NULL;
-  g_autoptr (ManetteBackend) backend = NULL;
-  g_autoptr (GError) error = NULL;
+  ProbeData *data = g_new0 (ProbeData, 1);
 
-  g_assert (self != NULL);
-  g_assert (filename != NULL);
+  g_weak_ref_init (&data->monitor, monitor);
+  data->filename = g_strdup (filename);
+  data->cancellable = g_cancellable_new ();
 
-  if (g_hash_table_contains (self->devices, filename))
-    return;
+  return data;
+}
 
-  if (is_hid)
-    backend = manette_hid_backend_new (filename);
-  else
-    backend = manette_evdev_backend_new (filename);
+static void
+probe_data_free (ProbeData *data)
+{
+  g_weak_ref_clear (&data->monitor);
+  g_clear_pointer (&data->filename, g_free);
+  g_clear_object (&data->cancellable);
+  g_clear_object (&data->next_backend);
+  g_free (data);
+}
 
-  if (!manette_backend_initialize (backend))
-    return;
+G_DEFINE_AUTOPTR_CLEANUP_FUNC (ProbeData, probe_data_free)
 
-  device = manette_device_new (g_steal_pointer (&backend), &error);
+static void
+queue_device_event (ManetteMonitor   *self,
+                    ManetteDevice    *device,
+                    ManetteEventType  type)
+{
+  ManetteEvent event = {
+    .type = type,
+    .device_id = manette_device_get_id (device),
+    .time = g_get_monotonic_time (),
+  };
+
+  if (self->event_queue)
+    manette_event_queue_push (self->event_queue, &event);
+}
+
+static void
+add_initialized_device (ManetteMonitor *self,
+                        const char     *filename,
+                        ManetteBackend *backend)
+{
+  g_autoptr (ManetteDevice) device = NULL;
+  g_autoptr (GError) error = NULL;
+
+  device = manette_device_new (backend, &error);
   if (G_UNLIKELY (error != NULL)) {
     if (!g_error_matches (error, G_FILE_ERROR, G_FILE_ERROR_NXIO))
       g_debug ("Failed to open %s: %s", filename, error->message);
@@ -133,24 +199,156 @@ add_device (ManetteMonitor *self,
   if (manette_device_supports_mapping (device))
     load_mapping (self, device);
 
+  if (self->event_queue)
+    manette_device_set_event_queue (device, self->event_queue);
+
+  manette_device_start (device, self->input_thread);
+
   g_hash_table_insert (self->devices,
                        g_strdup (filename),
                        g_object_ref (device));
+  queue_device_event (self, device, MANETTE_EVENT_DEVICE_CONNECTED);
   g_signal_emit (self, signals[SIG_DEVICE_CONNECTED], 0, device);
 }
 
 static void
-remove_device (ManetteMonitor *self,
-               const char     *filename)
+backend_initialized_cb (ManetteBackend *backend,
+                        GAsyncResult   *result,
+                        ProbeData      *data)
+{
+  g_autoptr (ProbeData) owned_data = data;
+  g_autoptr (ManetteMonitor) self = NULL;
+  g_autoptr (GError) error = NULL;
+  gboolean initialized;
+
+  initialized = manette_backend_initialize_finish (backend, result, &error);
+
+  self = g_weak_ref_get (&data->monitor);
+  if (self == NULL)
+    return;
+
+  g_assert (g_hash_table_lookup (self->probes, data->filename) == data);
+
+  g_hash_table_remove (self->probes, data->filename);
+
+  /* The device was removed meanwhile, initialize it again if it was plugged
+   * back in.
+   */
+  if (g_error_matches (error, G_IO_ERROR, G_IO_ERROR_CANCELLED)) {
+    if (data->next_backend != NULL)
+      manette_monitor_add_backend (self, data->filename,
+                                   g_steal_pointer (&data->next_backend));
+
+    return;
+  }
+
+  /* The backends report why on their own */
+  if (!initialized)
+    return;
+
+  add_initialized_device (self, data->filename, g_object_ref (backend));
+}
+
+static void
+cancel_probe (ProbeData *data)
+{
+  g_cancellable_cancel (data->cancellable);
+}
+
+/*
+ * manette_monitor_add_backend:
+ * @self: a monitor
+ * @filename: the filename of the device
+ * @backend: (transfer full): an uninitialized backend for the device
+ *
+ * Initializes @backend asynchronously, and adds a device for it once it's
+ * ready.
+ */
+void
+manette_monitor_add_backend (ManetteMonitor *self,
+                             const char     *filename,
+                             ManetteBackend *backend)
+{
+  g_autoptr (ManetteBackend) owned_backend = backend;
+  ProbeData *data;
+
+  g_return_if_fail (MANETTE_IS_MONITOR (self));
+  g_return_if_fail (filename != NULL);
+  g_return_if_fail (MANETTE_IS_BACKEND (backend));
+
+  if (g_hash_table_contains (self->devices, filename))
+    return;
+
+  /* Don't initialize the same device twice at once, wait for the cancelled
+   * initialization to be over instead.
+   */
+  data = g_hash_table_lookup (self->probes, filename);
+  if (data != NULL) {
+    if (g_cancellable_is_cancelled (data->cancellable))
+      g_set_object (&data->next_backend, backend);
+
+    return;
+  }
+
+  data = probe_data_new (self, filename);
+  g_hash_table_insert (self->probes, g_strdup (filename), data);
+  manette_backend_initialize_async (backend,
+                                    data->cancellable,
+                                    (GAsyncReadyCallback) backend_initialized_cb,
+                                    data);
+}
+
+static void
+add_device (ManetteMonitor *self,
+            const char     *filename,
+            gboolean        is_hid)
 {
+  ManetteBackend *backend;
+
+  g_assert (self != NULL);
+  g_assert (filename != NULL);
+
+  if (is_hid)
+    backend = manette_hid_backend_new (filename);
+  else
+    backend = manette_evdev_backend_new (filename);
+
+  manette_monitor_add_backend (self, filename, backend);
+}
+
+/*
+ * manette_monitor_remove_device:
+ * @self: a monitor
+ * @filename: the filename of the device
+ *
+ * Removes the device for @filename, or cancels its initialization.
+ */
+void
+manette_monitor_remove_device (ManetteMonitor *self,
+                               const char     *filename)
+{
+  ProbeData *data;
   ManetteDevice *device;
 
+  g_return_if_fail (MANETTE_IS_MONITOR (self));
+  g_return_if_fail (filename != NULL);
+
+  /* Cancelling removes it once the initialization is over */
+  data = g_hash_table_lookup (self->probes, filename);
+  if (data != NULL) {
+    g_cancellable_cancel (data->cancellable);
+    g_clear_object (&data->next_backend);
+
+    return;
+  }
+
   device = g_hash_table_lookup (self->devices, filename);
   if (device == NULL)
     return;
 
   g_object_ref (device);
   g_hash_table_remove (self->devices, filename);
+  queue_device_event (self, device, MANETTE_EVENT_DEVICE_DISCONNECTED);
   g_signal_emit_by_name (device, "disconnected");
   g_signal_emit (self, signals[SIG_DEVICE_DISCONNECTED], 0, device);
   g_object_unref (device);
@@ -180,7 +378,7 @@ remove_device_for_udev_device (ManetteMonitor *self,
   const char *filename;
 
   filename = g_udev_device_get_device_file (udev_device);
-  remove_device (self, filename);
+  manette_monitor_remove_device (self, filename);
 }
 
 static gboolean
@@ -356,7 +554,7 @@ file_deleted (ManetteMonitor *self,
 {
   g_autofree char *path = g_file_get_path (file);
 
-  remove_device (self, path);
+  manette_monitor_remove_device (self, path);
 }
 
 static void
@@ -463,6 +661,7 @@ init_file_backend (ManetteMonitor *self)
 
 static void
 mappings_changed_cb (ManetteMappingManager *mapping_manager,
+                     const char            *guid,
                      ManetteMonitor        *self)
 {
   GHashTableIter iter;
@@ -473,6 +672,9 @@ mappings_changed_cb (ManetteMappingManager *mapping_manager,
     if (!manette_device_supports_mapping (device))
       continue;
 
+    if (g_strcmp0 (manette_device_get_guid (device), guid) != 0)
+      continue;
+
     load_mapping (self, device);
   }
 }
@@ -497,16 +699,33 @@ manette_monitor_new (void)
 static void
 manette_monitor_init (ManetteMonitor *self)
 {
-  gboolean use_file_backend = FALSE;
-
   self->devices = g_hash_table_new_full (g_str_hash, g_str_equal,
                                          g_free, g_object_unref);
-  self->mapping_manager = manette_mapping_manager_new ();
+  self->probes = g_hash_table_new_full (g_str_hash, g_str_equal,
+                                        g_free, (GDestroyNotify) cancel_probe);
+  self->mapping_manager = manette_mapping_manager_dup_default ();
 
   g_signal_connect_object (self->mapping_manager,
                            "changed",
                            G_CALLBACK (mappings_changed_cb),
                            self, 0);
+}
+
+static void
+manette_monitor_constructed (GObject *object)
+{
+  ManetteMonitor *self = MANETTE_MONITOR (object);
+  gboolean use_file_backend = FALSE;
+
+  G_OBJECT_CLASS (manette_monitor_parent_class)->constructed (object);
+
+  if (self->use_input_thread)
+    self->input_thread = manette_input_thread_new ();
+
+  self->context = g_main_context_ref_thread_default ();
+  if (self->event_queue_size > 0)
+    self->event_queue = manette_event_queue_new (self->event_queue_size,
+                                                 self->event_queue_overflow);
 
 #if GUDEV_ENABLED
   use_file_backend = is_flatpak ();
@@ -530,6 +749,9 @@ manette_monitor_finalize (GObject *object)
 {
   ManetteMonitor *self = MANETTE_MONITOR (object);
 
+  /* Cancels the pending initializations */
+  g_clear_pointer (&self->probes, g_hash_table_unref);
+
 #ifdef GUDEV_ENABLED
   g_clear_object (&self->client);
 #endif
@@ -540,17 +762,125 @@ manette_monitor_finalize (GObject *object)
 
   g_clear_object (&self->mapping_manager);
   g_clear_pointer (&self->devices, g_hash_table_unref);
+  g_clear_pointer (&self->input_thread, manette_input_thread_unref);
+  g_clear_pointer (&self->event_queue, manette_event_queue_unref);
+  g_clear_pointer (&self->context, g_main_context_unref);
 
   G_OBJECT_CLASS (manette_monitor_parent_class)->finalize (object);
 }
 
+static void
+manette_monitor_get_property (GObject    *object,
+                              guint       prop_id,
+                              GValue     *value,
+                              GParamSpec *pspec)
+{
+  ManetteMonitor *self = MANETTE_MONITOR (object);
+
+  switch (prop_id) {
+  case PROP_USE_INPUT_THREAD:
+    g_value_set_boolean (value, self->use_input_thread);
+    break;
+
+  case PROP_EVENT_QUEUE_SIZE:
+    g_value_set_uint (value, self->event_queue_size);
+    break;
+
+  case PROP_EVENT_QUEUE_OVERFLOW:
+    g_value_set_enum (value, self->event_queue_overflow);
+    break;
+
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+  }
+}
+
+static void
+manette_monitor_set_property (GObject      *object,
+                              guint         prop_id,
+                              const GValue *value,
+                              GParamSpec   *pspec)
+{
+  ManetteMonitor *self = MANETTE_MONITOR (object);
+
+  switch (prop_id) {
+  case PROP_USE_INPUT_THREAD:
+    self->use_input_thread = g_value_get_boolean (value);
+    break;
+
+  case PROP_EVENT_QUEUE_SIZE:
+    self->event_queue_size = g_value_get_uint (value);
+    break;
+
+  case PROP_EVENT_QUEUE_OVERFLOW:
+    if (self->event_queue_overflow == g_value_get_enum (value))
+      break;
+
+    self->event_queue_overflow = g_value_get_enum (value);
+    if (self->event_queue)
+      manette_event_queue_set_overflow (self->event_queue, self->event_queue_overflow);
+    g_object_notify_by_pspec (object, pspec);
+    break;
+
+  default:
+    G_OBJECT_WARN_INVALID_PROPERTY_ID (object, prop_id, pspec);
+  }
+}
+
 static void
 manette_monitor_class_init (ManetteMonitorClass *klass)
 {
   manette_monitor_parent_class = g_type_class_peek_parent (klass);
   GObjectClass *object_class = G_OBJECT_CLASS (klass);
 
+  object_class->constructed = manette_monitor_constructed;
   object_class->finalize = manette_monitor_finalize;
+  object_class->get_property = manette_monitor_get_property;
+  object_class->set_property = manette_monitor_set_property;
+
+  /**
+   * ManetteMonitor:use-input-thread:
+   *
+   * Whether to read the events of the devices on a dedicated thread.
+   *
+   * The devices still emit their signals on the thread-default main context
+   * the monitor was created on, but the events are read and timestamped as
+   * soon as they arrive, even when that main context is busy.
+   */
+  props[PROP_USE_INPUT_THREAD] =
+    g_param_spec_boolean ("use-input-thread", NULL, NULL,
+                          FALSE,
+                          G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * ManetteMonitor:event-queue-size:
+   *
+   * The number of events to buffer for [method@Monitor.poll_events], or 0 to
+   * not buffer them.
+   *
+   * The events of all the devices, and their connections and disconnections,
+   * are then queued as they are emitted, for applications whose main loop
+   * isn't a GLib one.
+   */
+  props[PROP_EVENT_QUEUE_SIZE] =
+    g_param_spec_uint ("event-queue-size", NULL, NULL,
+                       0, G_MAXUINT16, 0,
+                       G_PARAM_READWRITE | G_PARAM_CONSTRUCT_ONLY | G_PARAM_STATIC_STRINGS);
+
+  /**
+   * ManetteMonitor:event-queue-overflow:
+   *
+   * What to do with the events arriving while the event queue is full.
+   *
+   * See [property@Monitor:event-queue-size].
+   */
+  props[PROP_EVENT_QUEUE_OVERFLOW] =
+    g_param_spec_enum ("event-queue-overflow", NULL, NULL,
+                       MANETTE_TYPE_EVENT_OVERFLOW,
+                       MANETTE_EVENT_OVERFLOW_DROP_NEWEST,
+                       G_PARAM_READWRITE | G_PARAM_EXPLICIT_NOTIFY | G_PARAM_STATIC_STRINGS);
+
+  g_object_class_install_properties (object_class, N_PROPS, props);
 
   /**
    * ManetteMonitor::device-connected:
@@ -592,6 +922,9 @@ manette_monitor_class_init (ManetteMonitorClass *klass)
  *
  * Lists the currently connected devices.
  *
+ * The devices still being initialized aren't listed yet, see
+ * [signal@Monitor::device-connected].
+ *
  * Returns: (transfer container) (array length=n_devices): the list of devices
  */
 ManetteDevice **
@@ -607,3 +940,83 @@ manette_monitor_list_devices (ManetteMonitor *self,
 
   return (ManetteDevice **) g_ptr_array_steal (devices, n_devices);
 }
+
+/**
+ * manette_monitor_get_device:
+ * @self: a monitor
+ * @id: the identifier of a device
+ *
+ * Gets the connected device identified by @id, e.g. from a [struct@Event].
+ *
+ * Returns: (transfer none) (nullable): the device, or %NULL if it's not
+ *   connected
+ */
+ManetteDevice *
+manette_monitor_get_device (ManetteMonitor *self,
+                            guint           id)
+{
+  GHashTableIter iter;
+  ManetteDevice *device;
+
+  g_return_val_if_fail (MANETTE_IS_MONITOR (self), NULL);
+
+  g_hash_table_iter_init (&iter, self->devices);
+  while (g_hash_table_iter_next (&iter, NULL, (gpointer *) &device))
+    if (manette_device_get_id (device) == id)
+      return device;
+
+  return NULL;
+}
+
+/**
+ * manette_monitor_poll_events:
+ * @self: a monitor
+ * @events: (out caller-allocates) (array length=n_events): return location
+ *   for the events
+ * @n_events: the number of events @events can hold
+ *
+ * Moves the oldest buffered events to @events.
+ *
+ * The pending sources of the thread-default main context @self was created
+ * on are dispatched first, without blocking, so the devices are read and
+ * hotplugged even if that main context isn't otherwise iterated. This must
+ * be called from the thread owning that main context.
+ *
+ * The events are only buffered if [property@Monitor:event-queue-size] is set.
+ *
+ * Returns: the number of events written to @events
+ */
+gsize
+manette_monitor_poll_events (ManetteMonitor *self,
+                             ManetteEvent   *events,
+                             gsize           n_events)
+{
+  g_return_val_if_fail (MANETTE_IS_MONITOR (self), 0);
+  g_return_val_if_fail (events != NULL || n_events == 0, 0);
+  g_return_val_if_fail (self->event_queue != NULL, 0);
+
+  g_main_context_iteration (self->context, FALSE);
+
+  return manette_event_queue_pop (self->event_queue, events, n_events);
+}
+
+/**
+ * manette_monitor_get_n_dropped_events:
+ * @self: a monitor
+ *
+ * Gets the number of events dropped because the event queue was full.
+ *
+ * See [property@Monitor:event-queue-overflow].
+ *
+ * Returns: the number of dropped events
+ */
+guint
+manette_monitor_get_n_dropped_events (ManetteMonitor *self)
+{
+  g_return_val_if_fail (MANETTE_IS_MONITOR (self), 0);
+
+  if (self->event_queue == NULL)
+    return 0;
+
+  return manette_event_queue_get_n_dropped (self->event_queue);
+}
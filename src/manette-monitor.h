@@ -27,6 +27,7 @@
 #include <glib-object.h>
 
 #include "manette-device.h"
+#include "manette-event.h"
 
 G_BEGIN_DECLS
 
@@ -42,4 +43,16 @@ MANETTE_AVAILABLE_IN_ALL
 ManetteDevice **manette_monitor_list_devices (ManetteMonitor *self,
                                               gsize          *n_devices);
 
+MANETTE_AVAILABLE_IN_ALL
+ManetteDevice *manette_monitor_get_device (ManetteMonitor *self,
+                                           guint           id);
+
+MANETTE_AVAILABLE_IN_ALL
+gsize manette_monitor_poll_events (ManetteMonitor *self,
+                                   ManetteEvent   *events,
+                                   gsize           n_events);
+
+MANETTE_AVAILABLE_IN_ALL
+guint manette_monitor_get_n_dropped_events (ManetteMonitor *self);
+
 G_END_DECLS
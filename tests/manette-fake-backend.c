@@ -0,0 +1,209 @@
+/* manette-fake-backend.c
+ *
+ * Copyright (C) 2026 The libmanette authors
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "manette-fake-backend.h"
+
+#include <fcntl.h>
+#include <glib-unix.h>
+#include <unistd.h>
+
+static void manette_fake_backend_backend_init (ManetteBackendInterface *iface);
+
+G_DEFINE_FINAL_TYPE_WITH_CODE (ManetteFakeBackend, manette_fake_backend, G_TYPE_OBJECT,
+                               G_IMPLEMENT_INTERFACE (MANETTE_TYPE_BACKEND,
+                                                      manette_fake_backend_backend_init))
+
+static gboolean
+read_event (GIOChannel         *source,
+            GIOCondition        condition,
+            ManetteFakeBackend *self)
+{
+  guint8 pressed;
+  gint64 time;
+
+  g_assert_cmpint (read (self->fds[0], &pressed, 1), ==, 1);
+
+  self->reading_thread = g_thread_self ();
+  time = g_get_monotonic_time ();
+  manette_backend_event_sink_emit_button (&self->event_sink, time,
+                                          MANETTE_BUTTON_SOUTH, pressed);
+  manette_backend_event_sink_emit_frame (&self->event_sink, time);
+
+  return G_SOURCE_CONTINUE;
+}
+
+static void
+manette_fake_backend_finalize (GObject *object)
+{
+  ManetteFakeBackend *self = MANETTE_FAKE_BACKEND (object);
+
+  close (self->fds[0]);
+  close (self->fds[1]);
+
+  G_OBJECT_CLASS (manette_fake_backend_parent_class)->finalize (object);
+}
+
+static void
+manette_fake_backend_class_init (ManetteFakeBackendClass *klass)
+{
+  GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+  object_class->finalize = manette_fake_backend_finalize;
+}
+
+static void
+manette_fake_backend_init (ManetteFakeBackend *self)
+{
+  g_autoptr (GError) error = NULL;
+
+  g_unix_open_pipe (self->fds, FD_CLOEXEC, &error);
+  g_assert_no_error (error);
+}
+
+static gboolean
+manette_fake_backend_initialize (ManetteBackend *backend)
+{
+  ManetteFakeBackend *self = MANETTE_FAKE_BACKEND (backend);
+
+  if (self->init_delay_ms > 0)
+    g_usleep (self->init_delay_ms * G_TIME_SPAN_MILLISECOND);
+
+  return TRUE;
+}
+
+static GSource *
+manette_fake_backend_create_source (ManetteBackend *backend)
+{
+  ManetteFakeBackend *self = MANETTE_FAKE_BACKEND (backend);
+  g_autoptr (GIOChannel) channel = NULL;
+  GSource *source;
+
+  channel = g_io_channel_unix_new (self->fds[0]);
+  source = g_io_create_watch (channel, G_IO_IN);
+  g_source_set_callback (source, (GSourceFunc) read_event, self, NULL);
+
+  return source;
+}
+
+static const char *
+manette_fake_backend_get_name (ManetteBackend *backend)
+{
+  return "Fake";
+}
+
+static int
+manette_fake_backend_get_id (ManetteBackend *backend)
+{
+  MANETTE_FAKE_BACKEND (backend)->n_queries++;
+
+  return 0;
+}
+
+static void
+manette_fake_backend_set_mapping (ManetteBackend *backend,
+                                  ManetteMapping *mapping)
+{
+}
+
+static gboolean
+manette_fake_backend_has_button (ManetteBackend *backend,
+                                 ManetteButton   button)
+{
+  MANETTE_FAKE_BACKEND (backend)->n_queries++;
+
+  return button == MANETTE_BUTTON_SOUTH;
+}
+
+static gboolean
+manette_fake_backend_has_axis (ManetteBackend *backend,
+                               ManetteAxis     axis)
+{
+  MANETTE_FAKE_BACKEND (backend)->n_queries++;
+
+  return FALSE;
+}
+
+static gboolean
+manette_fake_backend_has_input (ManetteBackend *backend,
+                                guint           type,
+                                guint           code)
+{
+  return FALSE;
+}
+
+static gboolean
+manette_fake_backend_has_rumble (ManetteBackend *backend)
+{
+  MANETTE_FAKE_BACKEND (backend)->n_queries++;
+
+  return FALSE;
+}
+
+static gboolean
+manette_fake_backend_rumble (ManetteBackend *backend,
+                             guint16         strong_magnitude,
+                             guint16         weak_magnitude,
+                             guint16         milliseconds)
+{
+  return FALSE;
+}
+
+static guint
+manette_fake_backend_get_n_dropped_frames (ManetteBackend *backend)
+{
+  ManetteFakeBackend *self = MANETTE_FAKE_BACKEND (backend);
+
+  return self->n_dropped_frames;
+}
+
+static ManetteBackendEventSink *
+manette_fake_backend_get_event_sink (ManetteBackend *backend)
+{
+  ManetteFakeBackend *self = MANETTE_FAKE_BACKEND (backend);
+
+  return &self->event_sink;
+}
+
+static void
+manette_fake_backend_backend_init (ManetteBackendInterface *iface)
+{
+  iface->initialize = manette_fake_backend_initialize;
+  iface->create_source = manette_fake_backend_create_source;
+  iface->get_name = manette_fake_backend_get_name;
+  iface->get_vendor_id = manette_fake_backend_get_id;
+  iface->get_product_id = manette_fake_backend_get_id;
+  iface->get_bustype_id = manette_fake_backend_get_id;
+  iface->get_version_id = manette_fake_backend_get_id;
+  iface->set_mapping = manette_fake_backend_set_mapping;
+  iface->has_button = manette_fake_backend_has_button;
+  iface->has_axis = manette_fake_backend_has_axis;
+  iface->has_input = manette_fake_backend_has_input;
+  iface->has_rumble = manette_fake_backend_has_rumble;
+  iface->rumble = manette_fake_backend_rumble;
+  iface->get_n_dropped_frames = manette_fake_backend_get_n_dropped_frames;
+  iface->get_event_sink = manette_fake_backend_get_event_sink;
+}
+
+void
+manette_fake_backend_send_event (ManetteFakeBackend *self,
+                                 gboolean            pressed)
+{
+  guint8 byte = pressed ? 1 : 0;
+
+  g_assert_cmpint (write (self->fds[1], &byte, 1), ==, 1);
+}
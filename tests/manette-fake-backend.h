@@ -0,0 +1,49 @@
+/* manette-fake-backend.h
+ *
+ * Copyright (C) 2026 The libmanette authors
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "../src/manette-backend-private.h"
+
+G_BEGIN_DECLS
+
+#define MANETTE_TYPE_FAKE_BACKEND (manette_fake_backend_get_type ())
+
+G_DECLARE_FINAL_TYPE (ManetteFakeBackend, manette_fake_backend, MANETTE, FAKE_BACKEND, GObject)
+
+/* A backend reading button events from a pipe, a byte per event. Its fields
+ * let the tests check and tweak how the device uses it.
+ */
+struct _ManetteFakeBackend
+{
+  GObject parent_instance;
+
+  int fds[2];
+  GThread *reading_thread;
+  /* How long initializing it blocks, like the Steam Deck's feature reports */
+  guint init_delay_ms;
+  guint n_dropped_frames;
+  guint n_queries;
+
+  ManetteBackendEventSink event_sink;
+};
+
+void manette_fake_backend_send_event (ManetteFakeBackend *self,
+                                      gboolean            pressed);
+
+G_END_DECLS
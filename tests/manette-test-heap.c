@@ -0,0 +1,147 @@
+/* manette-test-heap.c
+ *
+ * Copyright (C) 2026 The libmanette authors
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "manette-test-heap.h"
+
+#include <errno.h>
+#ifdef HAVE_MALLINFO2
+#include <malloc.h>
+#endif
+
+static guint n_allocations;
+
+#ifdef MANETTE_TEST_COUNT_ALLOCATIONS
+/* Count every allocation of the test by replacing the C library allocator's
+ * entry points. This is only built when the alloc-counting option allows it,
+ * as it can't be combined with the allocator of the sanitizers.
+ */
+
+extern void *__libc_malloc (size_t size);
+extern void *__libc_calloc (size_t n_members, size_t size);
+extern void *__libc_realloc (void *mem, size_t size);
+extern void *__libc_memalign (size_t alignment, size_t size);
+
+void *
+malloc (size_t size)
+{
+  g_atomic_int_inc (&n_allocations);
+
+  return __libc_malloc (size);
+}
+
+void *
+calloc (size_t n_members,
+        size_t size)
+{
+  g_atomic_int_inc (&n_allocations);
+
+  return __libc_calloc (n_members, size);
+}
+
+void *
+realloc (void   *mem,
+         size_t  size)
+{
+  g_atomic_int_inc (&n_allocations);
+
+  return __libc_realloc (mem, size);
+}
+
+void *
+memalign (size_t alignment,
+          size_t size)
+{
+  g_atomic_int_inc (&n_allocations);
+
+  return __libc_memalign (alignment, size);
+}
+
+void *
+aligned_alloc (size_t alignment,
+               size_t size)
+{
+  g_atomic_int_inc (&n_allocations);
+
+  return __libc_memalign (alignment, size);
+}
+
+int
+posix_memalign (void   **mem,
+                size_t   alignment,
+                size_t   size)
+{
+  void *result;
+
+  if (alignment % sizeof (void *) != 0 || (alignment & (alignment - 1)) != 0)
+    return EINVAL;
+
+  g_atomic_int_inc (&n_allocations);
+
+  result = __libc_memalign (alignment, size);
+  if (result == NULL)
+    return ENOMEM;
+
+  *mem = result;
+
+  return 0;
+}
+#endif
+
+/* Whether manette_test_heap_get_n_allocations() counts anything */
+gboolean
+manette_test_heap_can_count_allocations (void)
+{
+#ifdef MANETTE_TEST_COUNT_ALLOCATIONS
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+/* The number of allocations the test did so far, compare two of them to
+ * count the allocations of a code path.
+ */
+guint
+manette_test_heap_get_n_allocations (void)
+{
+  return g_atomic_int_get (&n_allocations);
+}
+
+/* Whether manette_test_heap_get_size() measures anything */
+gboolean
+manette_test_heap_can_get_size (void)
+{
+#ifdef HAVE_MALLINFO2
+  return TRUE;
+#else
+  return FALSE;
+#endif
+}
+
+/* The bytes of heap in use, compare two of them to measure what a code path
+ * keeps allocated.
+ */
+gsize
+manette_test_heap_get_size (void)
+{
+#ifdef HAVE_MALLINFO2
+  return mallinfo2 ().uordblks;
+#else
+  return 0;
+#endif
+}
@@ -0,0 +1,907 @@
+/* test-device.c
+ *
+ * Copyright (C) 2026 The libmanette authors
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../src/manette-device-private.h"
+#include "manette-fake-backend.h"
+
+#include <glib-unix.h>
+#include <unistd.h>
+
+#define N_EVENTS 100
+#define STALL_MS 10
+#define N_PERF_FRAMES 200000
+#define N_PERF_EMISSIONS 1000000
+#define WAKEUPS_MS 500
+#define POLL_INTERVAL_MS 4
+#define REPORT_INTERVAL_MS 4
+
+static void
+button_cb (ManetteDevice *device,
+           ManetteButton  button,
+           int           *n_events)
+{
+  g_assert_cmpint (button, ==, MANETTE_BUTTON_SOUTH);
+
+  (*n_events)++;
+}
+
+static ManetteDevice *
+new_device (ManetteFakeBackend **backend,
+            ManetteInputThread  *input_thread,
+            int                 *n_events)
+{
+  g_autoptr (GError) error = NULL;
+  ManetteDevice *device;
+
+  *backend = g_object_new (MANETTE_TYPE_FAKE_BACKEND, NULL);
+  device = manette_device_new (MANETTE_BACKEND (*backend), &error);
+  g_assert_no_error (error);
+
+  g_signal_connect (device, "button-pressed", G_CALLBACK (button_cb), n_events);
+  g_signal_connect (device, "button-released", G_CALLBACK (button_cb), n_events);
+
+  manette_device_start (device, input_thread);
+
+  return device;
+}
+
+static void
+test_direct (void)
+{
+  g_autoptr (ManetteDevice) device = NULL;
+  ManetteFakeBackend *backend;
+  int n_events = 0;
+
+  device = new_device (&backend, NULL, &n_events);
+
+  manette_fake_backend_send_event (backend, TRUE);
+  while (n_events < 1)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_true (backend->reading_thread == g_thread_self ());
+}
+
+static void
+test_input_thread (void)
+{
+  g_autoptr (ManetteInputThread) input_thread = manette_input_thread_new ();
+  g_autoptr (ManetteDevice) device = NULL;
+  ManetteFakeBackend *backend;
+  int n_events = 0;
+  int i;
+
+  device = new_device (&backend, input_thread, &n_events);
+
+  /* The events are read while the main context is busy, and are all
+   * dispatched in order once it's free.
+   */
+  for (i = 0; i < N_EVENTS; i++)
+    manette_fake_backend_send_event (backend, i % 2 == 0);
+
+  while (n_events < N_EVENTS)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpint (n_events, ==, N_EVENTS);
+  g_assert_true (backend->reading_thread != g_thread_self ());
+}
+
+static void
+test_input_thread_quit (void)
+{
+  int i;
+
+  /* Dropping the thread right away must not wait for its loop forever */
+  for (i = 0; i < N_EVENTS; i++)
+    manette_input_thread_unref (manette_input_thread_new ());
+}
+
+static void
+test_capabilities (void)
+{
+  g_autoptr (ManetteDevice) device = NULL;
+  g_autoptr (ManetteMapping) mapping = NULL;
+  g_autoptr (GError) error = NULL;
+  ManetteFakeBackend *backend;
+  int n_events = 0;
+  guint n_queries;
+  int i;
+
+  device = new_device (&backend, NULL, &n_events);
+  n_queries = backend->n_queries;
+
+  /* The capabilities are probed once, not on every query */
+  for (i = 0; i < N_EVENTS; i++) {
+    g_assert_true (manette_device_has_button (device, MANETTE_BUTTON_SOUTH));
+    g_assert_false (manette_device_has_button (device, MANETTE_BUTTON_NORTH));
+    g_assert_false (manette_device_has_axis (device, MANETTE_AXIS_LEFT_X));
+    g_assert_false (manette_device_has_rumble (device));
+    g_assert_cmpint (manette_device_get_vendor_id (device), ==, 0);
+    g_assert_cmpint (manette_device_get_product_id (device), ==, 0);
+  }
+
+  mapping = manette_mapping_new ("00000000000000000000000000000000,Fake,b:b0,leftx:a0,", &error);
+  g_assert_no_error (error);
+
+  manette_device_set_mapping (device, mapping);
+  g_assert_false (manette_device_has_button (device, MANETTE_BUTTON_SOUTH));
+  g_assert_true (manette_device_has_button (device, MANETTE_BUTTON_EAST));
+  g_assert_true (manette_device_has_axis (device, MANETTE_AXIS_LEFT_X));
+
+  manette_device_set_mapping (device, NULL);
+  g_assert_true (manette_device_has_button (device, MANETTE_BUTTON_SOUTH));
+  g_assert_false (manette_device_has_button (device, MANETTE_BUTTON_EAST));
+  g_assert_false (manette_device_has_axis (device, MANETTE_AXIS_LEFT_X));
+
+  g_assert_cmpuint (backend->n_queries, ==, n_queries);
+}
+
+static void
+test_state (void)
+{
+  g_autoptr (ManetteDevice) device = NULL;
+  ManetteFakeBackend *backend;
+  ManetteDeviceState state;
+  int n_events = 0;
+
+  device = new_device (&backend, NULL, &n_events);
+
+  manette_device_get_state (device, &state);
+  g_assert_cmpuint (state.buttons, ==, 0);
+  g_assert_cmpfloat (state.axes[MANETTE_AXIS_LEFT_X], ==, 0.0);
+  g_assert_cmpint (state.hats[0], ==, 0);
+
+  manette_backend_event_sink_emit_button (&backend->event_sink, 1, MANETTE_BUTTON_SOUTH, TRUE);
+  manette_backend_event_sink_emit_button (&backend->event_sink, 2, MANETTE_BUTTON_TOUCHPAD, TRUE);
+  manette_backend_event_sink_emit_axis (&backend->event_sink, 3, MANETTE_AXIS_LEFT_X, -0.5);
+  manette_backend_event_sink_emit_axis (&backend->event_sink, 4, MANETTE_AXIS_RIGHT_TRIGGER, 1.0);
+  manette_backend_event_sink_emit_unmapped_hat (&backend->event_sink, 5, 1, -1);
+  manette_backend_event_sink_emit_frame (&backend->event_sink, 5);
+
+  g_assert_true (manette_device_get_button_state (device, MANETTE_BUTTON_SOUTH));
+  g_assert_true (manette_device_get_button_state (device, MANETTE_BUTTON_TOUCHPAD));
+  g_assert_false (manette_device_get_button_state (device, MANETTE_BUTTON_NORTH));
+  g_assert_cmpfloat (manette_device_get_axis_value (device, MANETTE_AXIS_LEFT_X), ==, -0.5);
+  g_assert_cmpfloat (manette_device_get_axis_value (device, MANETTE_AXIS_RIGHT_TRIGGER), ==, 1.0);
+
+  manette_backend_event_sink_emit_button (&backend->event_sink, 6, MANETTE_BUTTON_SOUTH, FALSE);
+  manette_backend_event_sink_emit_frame (&backend->event_sink, 6);
+
+  manette_device_get_state (device, &state);
+  g_assert_cmpuint (state.buttons, ==, G_GUINT64_CONSTANT (1) << MANETTE_BUTTON_TOUCHPAD);
+  g_assert_cmpfloat (state.axes[MANETTE_AXIS_LEFT_X], ==, -0.5);
+  g_assert_cmpfloat (state.axes[MANETTE_AXIS_LEFT_Y], ==, 0.0);
+  g_assert_cmpint (state.hats[1], ==, -1);
+  g_assert_cmpuint (state.time, ==, 6);
+
+  g_assert_cmpuint (manette_device_get_n_dropped_frames (device), ==, 0);
+  backend->n_dropped_frames = 2;
+  g_assert_cmpuint (manette_device_get_n_dropped_frames (device), ==, 2);
+}
+
+static void
+test_event_time (void)
+{
+  g_autoptr (ManetteDevice) device = NULL;
+  ManetteFakeBackend *backend;
+  ManetteDeviceState state;
+  int n_events = 0;
+
+  device = new_device (&backend, NULL, &n_events);
+
+  /* The backends give the time in microseconds */
+  manette_backend_event_sink_emit_button (&backend->event_sink, 1500250, MANETTE_BUTTON_SOUTH, TRUE);
+  manette_backend_event_sink_emit_frame (&backend->event_sink, 1500250);
+
+  g_assert_cmpuint (manette_device_get_current_event_time (device), ==, 1500);
+  g_assert_cmpuint (manette_device_get_current_event_time_usec (device), ==, 1500250);
+
+  manette_device_get_state (device, &state);
+  g_assert_cmpuint (state.time, ==, 1500250);
+}
+
+typedef struct {
+  int n_axis_events;
+  int n_frames;
+  double x;
+  double y;
+} FrameData;
+
+static void
+axis_cb (ManetteDevice *device,
+         ManetteAxis    axis,
+         double         value,
+         FrameData     *data)
+{
+  /* Both axes are already up to date when the first one is emitted */
+  g_assert_cmpfloat (manette_device_get_axis_value (device, MANETTE_AXIS_LEFT_X), ==, data->x);
+  g_assert_cmpfloat (manette_device_get_axis_value (device, MANETTE_AXIS_LEFT_Y), ==, data->y);
+
+  data->n_axis_events++;
+}
+
+static void
+frame_cb (ManetteDevice *device,
+          FrameData     *data)
+{
+  ManetteDeviceState state;
+
+  manette_device_get_state (device, &state);
+  g_assert_cmpfloat (state.axes[MANETTE_AXIS_LEFT_X], ==, data->x);
+  g_assert_cmpfloat (state.axes[MANETTE_AXIS_LEFT_Y], ==, data->y);
+  g_assert_cmpuint (manette_device_get_current_event_time_usec (device), ==, 2);
+
+  data->n_frames++;
+}
+
+static void
+test_frame (void)
+{
+  g_autoptr (ManetteDevice) device = NULL;
+  ManetteFakeBackend *backend;
+  FrameData data = { 0, 0, 0.25, -0.75 };
+  int n_events = 0;
+
+  device = new_device (&backend, NULL, &n_events);
+  g_signal_connect (device, "absolute-axis-changed", G_CALLBACK (axis_cb), &data);
+  g_signal_connect (device, "frame", G_CALLBACK (frame_cb), &data);
+
+  /* Nothing is delivered until the frame ends */
+  manette_backend_event_sink_emit_axis (&backend->event_sink, 2, MANETTE_AXIS_LEFT_X, data.x);
+  manette_backend_event_sink_emit_axis (&backend->event_sink, 2, MANETTE_AXIS_LEFT_Y, data.y);
+  g_assert_cmpint (data.n_axis_events, ==, 0);
+  g_assert_cmpfloat (manette_device_get_axis_value (device, MANETTE_AXIS_LEFT_X), ==, 0.0);
+
+  manette_backend_event_sink_emit_frame (&backend->event_sink, 2);
+  g_assert_cmpint (data.n_axis_events, ==, 2);
+  g_assert_cmpint (data.n_frames, ==, 1);
+}
+
+typedef struct {
+  int n_frames;
+  gsize n_events;
+  ManetteEvent events[N_EVENTS];
+} FrameEventsData;
+
+static void
+frame_events_cb (ManetteDevice   *device,
+                 FrameEventsData *data)
+{
+  gsize n_events;
+
+  n_events = manette_device_get_frame_events (device,
+                                              data->events + data->n_events,
+                                              G_N_ELEMENTS (data->events) - data->n_events);
+  g_assert_cmpuint (data->n_events + n_events, <=, G_N_ELEMENTS (data->events));
+
+  data->n_events += n_events;
+  data->n_frames++;
+}
+
+static void
+test_frame_events (void)
+{
+  g_autoptr (ManetteDevice) device = NULL;
+  ManetteFakeBackend *backend;
+  FrameEventsData data = { 0 };
+  ManetteEvent event;
+  int n_events = 0;
+  int i;
+
+  device = new_device (&backend, NULL, &n_events);
+  g_signal_connect (device, "frame", G_CALLBACK (frame_events_cb), &data);
+
+  g_assert_cmpuint (manette_device_get_frame_events (device, &event, 1), ==, 0);
+
+  /* A frame-only listener sees a button pressed and released in a frame */
+  manette_backend_event_sink_emit_button (&backend->event_sink, 1, MANETTE_BUTTON_SOUTH, TRUE);
+  manette_backend_event_sink_emit_axis (&backend->event_sink, 2, MANETTE_AXIS_LEFT_X, 0.5);
+  manette_backend_event_sink_emit_button (&backend->event_sink, 3, MANETTE_BUTTON_SOUTH, FALSE);
+  manette_backend_event_sink_emit_frame (&backend->event_sink, 3);
+
+  g_assert_cmpint (data.n_frames, ==, 1);
+  g_assert_cmpuint (data.n_events, ==, 3);
+  g_assert_cmpint (data.events[0].type, ==, MANETTE_EVENT_BUTTON_PRESSED);
+  g_assert_cmpuint (data.events[0].index, ==, MANETTE_BUTTON_SOUTH);
+  g_assert_cmpuint (data.events[0].time, ==, 1);
+  g_assert_cmpint (data.events[1].type, ==, MANETTE_EVENT_ABSOLUTE_AXIS_CHANGED);
+  g_assert_cmpuint (data.events[1].index, ==, MANETTE_AXIS_LEFT_X);
+  g_assert_cmpfloat (data.events[1].value, ==, 0.5);
+  g_assert_cmpint (data.events[2].type, ==, MANETTE_EVENT_BUTTON_RELEASED);
+  g_assert_cmpuint (data.events[2].device_id, ==, manette_device_get_id (device));
+  g_assert_false (manette_device_get_button_state (device, MANETTE_BUTTON_SOUTH));
+
+  /* A long frame is split, still without losing any event */
+  data = (FrameEventsData) { 0 };
+  for (i = 0; i < N_EVENTS; i++)
+    manette_backend_event_sink_emit_button (&backend->event_sink, 4, MANETTE_BUTTON_SOUTH, i % 2 == 0);
+  manette_backend_event_sink_emit_frame (&backend->event_sink, 4);
+
+  g_assert_cmpint (data.n_frames, >, 1);
+  g_assert_cmpuint (data.n_events, ==, N_EVENTS);
+  for (i = 0; i < N_EVENTS; i++)
+    g_assert_cmpint (data.events[i].type, ==, i % 2 == 0 ? MANETTE_EVENT_BUTTON_PRESSED :
+                                                           MANETTE_EVENT_BUTTON_RELEASED);
+}
+
+typedef struct {
+  int n_button_events;
+  int n_axis_events;
+  int n_frames;
+  guint64 time;
+} SinkData;
+
+static void
+sink_button_event (ManetteDevice *device,
+                   guint64        time,
+                   ManetteButton  button,
+                   gboolean       pressed,
+                   SinkData      *data)
+{
+  data->n_button_events++;
+  data->time = time;
+}
+
+static void
+sink_absolute_axis_event (ManetteDevice *device,
+                          guint64        time,
+                          ManetteAxis    axis,
+                          double         value,
+                          SinkData      *data)
+{
+  data->n_axis_events++;
+  data->time = time;
+}
+
+static void
+sink_frame (ManetteDevice *device,
+            guint64        time,
+            SinkData      *data)
+{
+  data->n_frames++;
+  data->time = time;
+}
+
+static const ManetteDeviceEventSink sink = {
+  .button_event = (gpointer) sink_button_event,
+  .absolute_axis_event = (gpointer) sink_absolute_axis_event,
+  .frame = (gpointer) sink_frame,
+};
+
+static void
+test_event_sink (void)
+{
+  g_autoptr (ManetteDevice) device = NULL;
+  ManetteFakeBackend *backend;
+  SinkData data = { 0, };
+  int n_events = 0;
+
+  device = new_device (&backend, NULL, &n_events);
+  manette_device_set_event_sink (device, &sink, &data, NULL);
+
+  manette_backend_event_sink_emit_button (&backend->event_sink, 1, MANETTE_BUTTON_SOUTH, TRUE);
+  manette_backend_event_sink_emit_axis (&backend->event_sink, 1, MANETTE_AXIS_LEFT_X, 0.5);
+  g_assert_cmpint (data.n_button_events, ==, 0);
+
+  /* The sink gets the events along with the signals */
+  manette_backend_event_sink_emit_frame (&backend->event_sink, 2);
+  g_assert_cmpint (data.n_button_events, ==, 1);
+  g_assert_cmpint (data.n_axis_events, ==, 1);
+  g_assert_cmpint (data.n_frames, ==, 1);
+  g_assert_cmpuint (data.time, ==, 2);
+  g_assert_cmpint (n_events, ==, 1);
+
+  manette_device_set_event_sink (device, NULL, NULL, NULL);
+
+  manette_backend_event_sink_emit_button (&backend->event_sink, 3, MANETTE_BUTTON_SOUTH, FALSE);
+  manette_backend_event_sink_emit_frame (&backend->event_sink, 3);
+  g_assert_cmpint (data.n_button_events, ==, 1);
+  g_assert_cmpint (n_events, ==, 2);
+}
+
+static void
+signal_button_cb (ManetteDevice *device,
+                  ManetteButton  button,
+                  SinkData      *data)
+{
+  data->n_button_events++;
+}
+
+static void
+signal_axis_cb (ManetteDevice *device,
+                ManetteAxis    axis,
+                double         value,
+                SinkData      *data)
+{
+  data->n_axis_events++;
+}
+
+static void
+signal_frame_cb (ManetteDevice *device,
+                 SinkData      *data)
+{
+  data->n_frames++;
+}
+
+/* Returns the events delivered per second */
+static double
+measure_event_rate (gboolean use_sink)
+{
+  g_autoptr (ManetteFakeBackend) backend = NULL;
+  g_autoptr (ManetteDevice) device = NULL;
+  g_autoptr (GError) error = NULL;
+  SinkData data = { 0, };
+  double elapsed;
+  int i;
+
+  backend = g_object_new (MANETTE_TYPE_FAKE_BACKEND, NULL);
+  device = manette_device_new (g_object_ref (MANETTE_BACKEND (backend)), &error);
+  g_assert_no_error (error);
+
+  if (use_sink) {
+    manette_device_set_event_sink (device, &sink, &data, NULL);
+  } else {
+    g_signal_connect (device, "button-pressed", G_CALLBACK (signal_button_cb), &data);
+    g_signal_connect (device, "button-released", G_CALLBACK (signal_button_cb), &data);
+    g_signal_connect (device, "absolute-axis-changed", G_CALLBACK (signal_axis_cb), &data);
+    g_signal_connect (device, "frame", G_CALLBACK (signal_frame_cb), &data);
+  }
+
+  /* A button and a stick moving every frame */
+  g_test_timer_start ();
+  for (i = 0; i < N_PERF_FRAMES; i++) {
+    manette_backend_event_sink_emit_button (&backend->event_sink, i, MANETTE_BUTTON_SOUTH, i % 2 == 0);
+    manette_backend_event_sink_emit_axis (&backend->event_sink, i, MANETTE_AXIS_LEFT_X, 0.5);
+    manette_backend_event_sink_emit_axis (&backend->event_sink, i, MANETTE_AXIS_LEFT_Y, -0.5);
+    manette_backend_event_sink_emit_frame (&backend->event_sink, i);
+  }
+  elapsed = g_test_timer_elapsed ();
+
+  g_assert_cmpint (data.n_button_events, ==, N_PERF_FRAMES);
+  g_assert_cmpint (data.n_axis_events, ==, N_PERF_FRAMES * 2);
+  g_assert_cmpint (data.n_frames, ==, N_PERF_FRAMES);
+
+  return N_PERF_FRAMES * 4 / elapsed;
+}
+
+static void
+test_event_sink_perf (void)
+{
+  double signal_rate, sink_rate;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("Performance tests not enabled, use -m perf");
+
+    return;
+  }
+
+  signal_rate = measure_event_rate (FALSE);
+  sink_rate = measure_event_rate (TRUE);
+
+  g_test_maximized_result (signal_rate,
+                           "Events delivered through signals: %.0f/s",
+                           signal_rate);
+  g_test_maximized_result (sink_rate,
+                           "Events delivered through an event sink: %.0f/s",
+                           sink_rate);
+}
+
+static void
+unmapped_button_cb (ManetteDevice *device,
+                    guint          index,
+                    int           *n_unmapped_events)
+{
+  (*n_unmapped_events)++;
+}
+
+static void
+test_unmapped_events (void)
+{
+  g_autoptr (ManetteDevice) device = NULL;
+  ManetteFakeBackend *backend;
+  int n_events = 0;
+  int n_unmapped_events = 0;
+
+  device = new_device (&backend, NULL, &n_events);
+  g_signal_connect (device, "unmapped-button-pressed", G_CALLBACK (unmapped_button_cb), &n_unmapped_events);
+  g_signal_connect (device, "unmapped-button-released", G_CALLBACK (unmapped_button_cb), &n_unmapped_events);
+
+  /* The unmapped events are emitted by default */
+  g_assert_true (manette_device_get_unmapped_events_enabled (device));
+  manette_backend_event_sink_emit_unmapped_button (&backend->event_sink, 1, 3, TRUE);
+  manette_backend_event_sink_emit_frame (&backend->event_sink, 1);
+  g_assert_cmpint (n_unmapped_events, ==, 1);
+
+  manette_device_set_unmapped_events_enabled (device, FALSE);
+  g_assert_false (manette_device_get_unmapped_events_enabled (device));
+  manette_backend_event_sink_emit_unmapped_button (&backend->event_sink, 2, 3, FALSE);
+  manette_backend_event_sink_emit_frame (&backend->event_sink, 2);
+  g_assert_cmpint (n_unmapped_events, ==, 1);
+
+  /* The mapped events are passed regardless */
+  manette_backend_event_sink_emit_button (&backend->event_sink, 3, MANETTE_BUTTON_SOUTH, TRUE);
+  manette_backend_event_sink_emit_frame (&backend->event_sink, 3);
+  g_assert_cmpint (n_events, ==, 1);
+
+  manette_device_set_unmapped_events_enabled (device, TRUE);
+  manette_backend_event_sink_emit_unmapped_button (&backend->event_sink, 4, 3, TRUE);
+  manette_backend_event_sink_emit_frame (&backend->event_sink, 4);
+  g_assert_cmpint (n_unmapped_events, ==, 2);
+}
+
+/* Returns the mapped events delivered per second */
+static double
+measure_mapped_event_rate (gboolean unmapped_enabled)
+{
+  g_autoptr (ManetteFakeBackend) backend = NULL;
+  g_autoptr (ManetteDevice) device = NULL;
+  g_autoptr (GError) error = NULL;
+  SinkData data = { 0, };
+  int n_unmapped_events = 0;
+  double elapsed;
+  int i;
+
+  backend = g_object_new (MANETTE_TYPE_FAKE_BACKEND, NULL);
+  device = manette_device_new (g_object_ref (MANETTE_BACKEND (backend)), &error);
+  g_assert_no_error (error);
+
+  g_signal_connect (device, "button-pressed", G_CALLBACK (signal_button_cb), &data);
+  g_signal_connect (device, "button-released", G_CALLBACK (signal_button_cb), &data);
+  g_signal_connect (device, "absolute-axis-changed", G_CALLBACK (signal_axis_cb), &data);
+
+  g_signal_connect (device, "unmapped-button-pressed", G_CALLBACK (unmapped_button_cb), &n_unmapped_events);
+  g_signal_connect (device, "unmapped-button-released", G_CALLBACK (unmapped_button_cb), &n_unmapped_events);
+
+  manette_device_set_unmapped_events_enabled (device, unmapped_enabled);
+
+  /* Like an evdev device, each input comes both unmapped and mapped */
+  g_test_timer_start ();
+  for (i = 0; i < N_PERF_FRAMES; i++) {
+    manette_backend_event_sink_emit_unmapped_button (&backend->event_sink, i, 0, i % 2 == 0);
+    manette_backend_event_sink_emit_button (&backend->event_sink, i, MANETTE_BUTTON_SOUTH, i % 2 == 0);
+    manette_backend_event_sink_emit_unmapped_absolute (&backend->event_sink, i, 0, 0.5);
+    manette_backend_event_sink_emit_axis (&backend->event_sink, i, MANETTE_AXIS_LEFT_X, 0.5);
+    manette_backend_event_sink_emit_unmapped_absolute (&backend->event_sink, i, 1, -0.5);
+    manette_backend_event_sink_emit_axis (&backend->event_sink, i, MANETTE_AXIS_LEFT_Y, -0.5);
+    manette_backend_event_sink_emit_frame (&backend->event_sink, i);
+  }
+  elapsed = g_test_timer_elapsed ();
+
+  g_assert_cmpint (data.n_button_events, ==, N_PERF_FRAMES);
+  g_assert_cmpint (data.n_axis_events, ==, N_PERF_FRAMES * 2);
+  g_assert_cmpint (n_unmapped_events, ==, unmapped_enabled ? N_PERF_FRAMES : 0);
+
+  return N_PERF_FRAMES * 3 / elapsed;
+}
+
+static void
+test_unmapped_events_perf (void)
+{
+  double enabled_rate, disabled_rate;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("Performance tests not enabled, use -m perf");
+
+    return;
+  }
+
+  enabled_rate = measure_mapped_event_rate (TRUE);
+  disabled_rate = measure_mapped_event_rate (FALSE);
+
+  g_test_maximized_result (enabled_rate,
+                           "Mapped events delivered with the unmapped events: %.0f/s",
+                           enabled_rate);
+  g_test_maximized_result (disabled_rate,
+                           "Mapped events delivered without the unmapped events: %.0f/s",
+                           disabled_rate);
+}
+
+/* An object with the same signal as ManetteDevice::absolute-axis-changed, but
+ * using the generic marshaller.
+ */
+#define MANETTE_TYPE_GENERIC_EMITTER (manette_generic_emitter_get_type ())
+
+G_DECLARE_FINAL_TYPE (ManetteGenericEmitter, manette_generic_emitter, MANETTE, GENERIC_EMITTER, GObject)
+
+struct _ManetteGenericEmitter
+{
+  GObject parent_instance;
+};
+
+G_DEFINE_FINAL_TYPE (ManetteGenericEmitter, manette_generic_emitter, G_TYPE_OBJECT)
+
+static void
+manette_generic_emitter_class_init (ManetteGenericEmitterClass *klass)
+{
+  g_signal_new ("absolute-axis-changed",
+                MANETTE_TYPE_GENERIC_EMITTER,
+                G_SIGNAL_RUN_LAST,
+                0, NULL, NULL,
+                NULL,
+                G_TYPE_NONE, 2,
+                MANETTE_TYPE_AXIS, G_TYPE_DOUBLE);
+}
+
+static void
+manette_generic_emitter_init (ManetteGenericEmitter *self)
+{
+}
+
+/* Returns the emissions per second */
+static double
+measure_emission_rate (GObject *object)
+{
+  SinkData data = { 0, };
+  guint signal_id;
+  double elapsed;
+  int i;
+
+  signal_id = g_signal_lookup ("absolute-axis-changed", G_OBJECT_TYPE (object));
+  g_signal_connect (object, "absolute-axis-changed", G_CALLBACK (signal_axis_cb), &data);
+
+  g_test_timer_start ();
+  for (i = 0; i < N_PERF_EMISSIONS; i++)
+    g_signal_emit (object, signal_id, 0, MANETTE_AXIS_LEFT_X, 0.5);
+  elapsed = g_test_timer_elapsed ();
+
+  g_assert_cmpint (data.n_axis_events, ==, N_PERF_EMISSIONS);
+
+  return N_PERF_EMISSIONS / elapsed;
+}
+
+static void
+test_signal_emission_perf (void)
+{
+  g_autoptr (ManetteDevice) device = NULL;
+  g_autoptr (GObject) generic_emitter = NULL;
+  ManetteFakeBackend *backend;
+  double generic_rate, specialized_rate;
+  int n_events = 0;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("Performance tests not enabled, use -m perf");
+
+    return;
+  }
+
+  generic_emitter = g_object_new (MANETTE_TYPE_GENERIC_EMITTER, NULL);
+  generic_rate = measure_emission_rate (generic_emitter);
+
+  device = new_device (&backend, NULL, &n_events);
+  specialized_rate = measure_emission_rate (G_OBJECT (device));
+
+  g_test_maximized_result (generic_rate,
+                           "Emissions with the generic marshaller: %.0f/s",
+                           generic_rate);
+  g_test_maximized_result (specialized_rate,
+                           "Emissions with the generated marshallers: %.0f/s",
+                           specialized_rate);
+}
+
+static double
+measure_stalled_latency (ManetteInputThread *input_thread)
+{
+  g_autoptr (ManetteDevice) device = NULL;
+  ManetteFakeBackend *backend;
+  int n_events = 0;
+  gint64 total = 0;
+  int i;
+
+  device = new_device (&backend, input_thread, &n_events);
+
+  for (i = 0; i < N_EVENTS; i++) {
+    gint64 sent_time = g_get_monotonic_time ();
+
+    manette_fake_backend_send_event (backend, i % 2 == 0);
+
+    /* Pretend the application is busy drawing a slow frame */
+    g_usleep (STALL_MS * 1000);
+
+    while (n_events <= i)
+      g_main_context_iteration (NULL, TRUE);
+
+    total += manette_device_get_current_event_time_usec (device) - sent_time;
+  }
+
+  return (double) total / N_EVENTS;
+}
+
+static void
+test_stalled_latency_perf (void)
+{
+  g_autoptr (ManetteInputThread) input_thread = NULL;
+  double direct_latency, threaded_latency;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("Performance tests not enabled, use -m perf");
+
+    return;
+  }
+
+  direct_latency = measure_stalled_latency (NULL);
+
+  input_thread = manette_input_thread_new ();
+  threaded_latency = measure_stalled_latency (input_thread);
+
+  g_test_minimized_result (direct_latency,
+                           "Read latency on a %d ms stalled main context: %.2f µs",
+                           STALL_MS, direct_latency);
+  g_test_minimized_result (threaded_latency,
+                           "Read latency on the input thread: %.2f µs",
+                           threaded_latency);
+
+  g_assert_cmpfloat (threaded_latency, <, direct_latency);
+}
+
+static gboolean
+stop_counting_cb (gboolean *done)
+{
+  *done = TRUE;
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Counts how many times a thread running @context wakes up in WAKEUPS_MS */
+static guint
+count_wakeups (GMainContext *context)
+{
+  g_autoptr (GSource) timeout = g_timeout_source_new (WAKEUPS_MS);
+  gboolean done = FALSE;
+  guint n_wakeups = 0;
+
+  g_source_set_callback (timeout, G_SOURCE_FUNC (stop_counting_cb), &done, NULL);
+  g_source_attach (timeout, context);
+
+  while (!done) {
+    g_main_context_iteration (context, TRUE);
+    n_wakeups++;
+  }
+
+  /* Not counting the wakeup ending the count */
+  return n_wakeups - 1;
+}
+
+static gpointer
+send_reports_thread_func (ManetteFakeBackend *backend)
+{
+  gint64 end_time = g_get_monotonic_time () + WAKEUPS_MS * G_TIME_SPAN_MILLISECOND;
+
+  while (g_get_monotonic_time () < end_time) {
+    manette_fake_backend_send_event (backend, TRUE);
+    g_usleep (REPORT_INTERVAL_MS * G_TIME_SPAN_MILLISECOND);
+  }
+
+  return NULL;
+}
+
+static guint
+count_active_wakeups (GMainContext       *context,
+                      ManetteFakeBackend *backend)
+{
+  g_autoptr (GThread) thread = NULL;
+  guint n_wakeups;
+
+  thread = g_thread_new ("send-reports", (GThreadFunc) send_reports_thread_func, backend);
+  n_wakeups = count_wakeups (context);
+  g_thread_join (g_steal_pointer (&thread));
+
+  return n_wakeups;
+}
+
+static gboolean
+poll_reports_cb (ManetteFakeBackend *backend)
+{
+  guint8 byte;
+
+  while (read (backend->fds[0], &byte, 1) == 1)
+    manette_backend_event_sink_emit_frame (&backend->event_sink, g_get_monotonic_time ());
+
+  return G_SOURCE_CONTINUE;
+}
+
+/* Compares the wakeups of watching a pipe of fake reports with polling it
+ * every few milliseconds. This only shows what a file descriptor watch saves
+ * over a timeout: the HID backend itself needs a device to run, and the
+ * Steam Deck driver's watchdog wakes its own thread regardless.
+ */
+static void
+test_wakeups_perf (void)
+{
+  g_autoptr (GMainContext) context = g_main_context_new ();
+  double watched_idle, watched_active, polled_idle, polled_active;
+  g_autoptr (GError) error = NULL;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("Performance tests not enabled, use -m perf");
+
+    return;
+  }
+
+  g_main_context_push_thread_default (context);
+
+  {
+    g_autoptr (ManetteDevice) device = NULL;
+    ManetteFakeBackend *backend;
+    int n_events = 0;
+
+    device = new_device (&backend, NULL, &n_events);
+
+    watched_idle = count_wakeups (context);
+    watched_active = count_active_wakeups (context, backend);
+  }
+
+  {
+    g_autoptr (ManetteFakeBackend) backend = NULL;
+    g_autoptr (GSource) poll_source = NULL;
+
+    backend = g_object_new (MANETTE_TYPE_FAKE_BACKEND, NULL);
+    g_unix_set_fd_nonblocking (backend->fds[0], TRUE, &error);
+    g_assert_no_error (error);
+
+    poll_source = g_timeout_source_new (POLL_INTERVAL_MS);
+    g_source_set_callback (poll_source, G_SOURCE_FUNC (poll_reports_cb), backend, NULL);
+    g_source_attach (poll_source, context);
+
+    polled_idle = count_wakeups (context);
+    polled_active = count_active_wakeups (context, backend);
+
+    g_source_destroy (poll_source);
+  }
+
+  g_main_context_pop_thread_default (context);
+
+  /* Nothing else is attached to the context, so nothing wakes it up */
+  g_assert_cmpfloat (watched_idle, ==, 0);
+
+  g_test_minimized_result (watched_idle * 1000 / WAKEUPS_MS,
+                           "Idle wakeups when watching: %.1f/s",
+                           watched_idle * 1000 / WAKEUPS_MS);
+  g_test_minimized_result (polled_idle * 1000 / WAKEUPS_MS,
+                           "Idle wakeups when polling every %d ms: %.1f/s",
+                           POLL_INTERVAL_MS, polled_idle * 1000 / WAKEUPS_MS);
+  g_test_minimized_result (watched_active * 1000 / WAKEUPS_MS,
+                           "Wakeups when watching a report every %d ms: %.1f/s",
+                           REPORT_INTERVAL_MS, watched_active * 1000 / WAKEUPS_MS);
+  g_test_minimized_result (polled_active * 1000 / WAKEUPS_MS,
+                           "Wakeups when polling a report every %d ms: %.1f/s",
+                           REPORT_INTERVAL_MS, polled_active * 1000 / WAKEUPS_MS);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  g_test_init (&argc, &argv, NULL);
+
+  g_test_add_func ("/ManetteDevice/test_direct", test_direct);
+  g_test_add_func ("/ManetteDevice/test_input_thread", test_input_thread);
+  g_test_add_func ("/ManetteDevice/test_input_thread_quit", test_input_thread_quit);
+  g_test_add_func ("/ManetteDevice/test_capabilities", test_capabilities);
+  g_test_add_func ("/ManetteDevice/test_state", test_state);
+  g_test_add_func ("/ManetteDevice/test_event_time", test_event_time);
+  g_test_add_func ("/ManetteDevice/test_frame", test_frame);
+  g_test_add_func ("/ManetteDevice/test_frame_events", test_frame_events);
+  g_test_add_func ("/ManetteDevice/test_event_sink", test_event_sink);
+  g_test_add_func ("/ManetteDevice/test_unmapped_events", test_unmapped_events);
+  g_test_add_func ("/ManetteDevice/test_stalled_latency_perf", test_stalled_latency_perf);
+  g_test_add_func ("/ManetteDevice/test_event_sink_perf", test_event_sink_perf);
+  g_test_add_func ("/ManetteDevice/test_unmapped_events_perf", test_unmapped_events_perf);
+  g_test_add_func ("/ManetteDevice/test_signal_emission_perf", test_signal_emission_perf);
+  g_test_add_func ("/ManetteDevice/test_wakeups_perf", test_wakeups_perf);
+
+  return g_test_run();
+}
@@ -17,6 +17,7 @@
  */
 
 #include "../src/manette-event-mapping-private.h"
+#include "manette-test-heap.h"
 
 #define MAPPING_EMPTY "00000000000000000000000000000000,empty,"
 #define MAPPING_BUTTON "00000000000000000000000000000000,button,a:b0,b:b1,x:b2,y:b3,"
@@ -24,6 +25,10 @@
 #define MAPPING_HAT "00000000000000000000000000000000,hat,dpleft:h0.8,dpright:h0.2,dpup:h0.1,dpdown:h0.4,"
 #define MAPPING_AXIS_DPAD "00000000000000000000000000000000,button,dpleft:-a0,dpright:+a0,dpup:-a1,dpdown:+a1,"
 #define MAPPING_AXIS_TRIGGER "00000000000000000000000000000000,trigger,lefttrigger:a0,righttrigger:a1,"
+#define MAPPING_TRIGGER_BUTTON "00000000000000000000000000000000,trigger button,leftshoulder:a0,"
+#define MAPPING_SHARED_BUTTON "00000000000000000000000000000000,shared button,leftshoulder:a0,leftshoulder:b0,"
+
+#define N_EVENTS 1000000
 
 static void
 test_null (void)
@@ -43,7 +48,8 @@ static void
 test_empty_mapping (void)
 {
   g_autoptr (ManetteMapping) mapping = NULL;
-  GSList *mapped_events;
+  ManetteMappedEvent mapped_events[MANETTE_MAX_MAPPED_EVENTS];
+  gsize n_mapped_events;
   GError *error = NULL;
 
   mapping = manette_mapping_new (MAPPING_EMPTY, &error);
@@ -51,15 +57,17 @@ test_empty_mapping (void)
   g_assert_nonnull (mapping);
   g_assert_true (MANETTE_IS_MAPPING (mapping));
 
-  mapped_events = manette_map_button_event (mapping, 0, TRUE);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 0);
+  n_mapped_events = manette_map_button_event (mapping, NULL, 0, TRUE,
+                                              mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 0);
 }
 
 static void
 test_button_mapping (void)
 {
   g_autoptr (ManetteMapping) mapping = NULL;
-  GSList *mapped_events;
+  ManetteMappedEvent mapped_events[MANETTE_MAX_MAPPED_EVENTS];
+  gsize n_mapped_events;
   ManetteMappedEvent *mapped_event;
   GError *error = NULL;
 
@@ -68,22 +76,22 @@ test_button_mapping (void)
   g_assert_nonnull (mapping);
   g_assert_true (MANETTE_IS_MAPPING (mapping));
 
-  mapped_events = manette_map_button_event (mapping, 0, TRUE);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 1);
+  n_mapped_events = manette_map_button_event (mapping, NULL, 0, TRUE,
+                                              mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 1);
 
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpint (mapped_event->button.button, ==, MANETTE_BUTTON_SOUTH);
   g_assert_true (mapped_event->button.pressed);
-
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
 }
 
 static void
 test_axis_mapping (void)
 {
   g_autoptr (ManetteMapping) mapping = NULL;
-  GSList *mapped_events;
+  ManetteMappedEvent mapped_events[MANETTE_MAX_MAPPED_EVENTS];
+  gsize n_mapped_events;
   ManetteMappedEvent *mapped_event;
   GError *error = NULL;
 
@@ -92,32 +100,31 @@ test_axis_mapping (void)
   g_assert_nonnull (mapping);
   g_assert_true (MANETTE_IS_MAPPING (mapping));
 
-  mapped_events = manette_map_absolute_event (mapping, 0, 0.0);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 1);
+  n_mapped_events = manette_map_absolute_event (mapping, NULL, 0, 0.0,
+                                                mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 1);
 
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_AXIS);
   g_assert_cmpint (mapped_event->axis.axis, ==, MANETTE_AXIS_LEFT_X);
   g_assert_cmpfloat (mapped_event->axis.value, ==, 0);
 
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
-
-  mapped_events = manette_map_absolute_event (mapping, 1, 0.0);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 1);
+  n_mapped_events = manette_map_absolute_event (mapping, NULL, 1, 0.0,
+                                                mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 1);
 
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_AXIS);
   g_assert_cmpint (mapped_event->axis.axis, ==, MANETTE_AXIS_LEFT_Y);
   g_assert_cmpfloat (mapped_event->axis.value, ==, 0);
-
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
 }
 
 static void
 test_hat_mapping (void)
 {
   g_autoptr (ManetteMapping) mapping = NULL;
-  GSList *mapped_events;
+  ManetteMappedEvent mapped_events[MANETTE_MAX_MAPPED_EVENTS];
+  gsize n_mapped_events;
   ManetteMappedEvent *mapped_event;
   GError *error = NULL;
 
@@ -126,57 +133,55 @@ test_hat_mapping (void)
   g_assert_nonnull (mapping);
   g_assert_true (MANETTE_IS_MAPPING (mapping));
 
-  mapped_events = manette_map_hat_event (mapping, 0, 0);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 2);
+  n_mapped_events = manette_map_hat_event (mapping, NULL, 0, 0,
+                                           mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 2);
 
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_LEFT);
   g_assert_false (mapped_event->button.pressed);
 
-  mapped_event = mapped_events->next->data;
+  mapped_event = &mapped_events[1];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_RIGHT);
   g_assert_false (mapped_event->button.pressed);
 
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
-
-  mapped_events = manette_map_hat_event (mapping, 0, -1);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 2);
+  n_mapped_events = manette_map_hat_event (mapping, NULL, 0, -1,
+                                           mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 2);
 
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_LEFT);
   g_assert_true (mapped_event->button.pressed);
 
-  mapped_event = mapped_events->next->data;
+  mapped_event = &mapped_events[1];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_RIGHT);
   g_assert_false (mapped_event->button.pressed);
 
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
+  n_mapped_events = manette_map_hat_event (mapping, NULL, 0, 1,
+                                           mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 2);
 
-  mapped_events = manette_map_hat_event (mapping, 0, 1);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 2);
-
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_LEFT);
   g_assert_false (mapped_event->button.pressed);
 
-  mapped_event = mapped_events->next->data;
+  mapped_event = &mapped_events[1];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_RIGHT);
   g_assert_true (mapped_event->button.pressed);
-
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
 }
 
 static void
 test_axis_dpad_mapping (void)
 {
   g_autoptr (ManetteMapping) mapping = NULL;
-  GSList *mapped_events;
+  ManetteMappedEvent mapped_events[MANETTE_MAX_MAPPED_EVENTS];
+  gsize n_mapped_events;
   ManetteMappedEvent *mapped_event;
   GError *error = NULL;
 
@@ -185,102 +190,97 @@ test_axis_dpad_mapping (void)
   g_assert_nonnull (mapping);
   g_assert_true (MANETTE_IS_MAPPING (mapping));
 
-  mapped_events = manette_map_absolute_event (mapping, 0, 0.0);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 2);
+  n_mapped_events = manette_map_absolute_event (mapping, NULL, 0, 0.0,
+                                                mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 2);
 
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_LEFT);
   g_assert_false (mapped_event->button.pressed);
 
-  mapped_event = mapped_events->next->data;
+  mapped_event = &mapped_events[1];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_RIGHT);
   g_assert_false (mapped_event->button.pressed);
 
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
+  n_mapped_events = manette_map_absolute_event (mapping, NULL, 0, -1.0,
+                                                mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 2);
 
-  mapped_events = manette_map_absolute_event (mapping, 0, -1.0);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 2);
-
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_LEFT);
   g_assert_true (mapped_event->button.pressed);
 
-  mapped_event = mapped_events->next->data;
+  mapped_event = &mapped_events[1];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpuint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_RIGHT);
   g_assert_false (mapped_event->button.pressed);
 
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
-
-  mapped_events = manette_map_absolute_event (mapping, 0, 1.0);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 2);
+  n_mapped_events = manette_map_absolute_event (mapping, NULL, 0, 1.0,
+                                                mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 2);
 
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpuint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_LEFT);
   g_assert_false (mapped_event->button.pressed);
 
-  mapped_event = mapped_events->next->data;
+  mapped_event = &mapped_events[1];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpuint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_RIGHT);
   g_assert_true (mapped_event->button.pressed);
 
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
+  n_mapped_events = manette_map_absolute_event (mapping, NULL, 1, 0.0,
+                                                mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 2);
 
-  mapped_events = manette_map_absolute_event (mapping, 1, 0.0);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 2);
-
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_UP);
   g_assert_false (mapped_event->button.pressed);
 
-  mapped_event = mapped_events->next->data;
+  mapped_event = &mapped_events[1];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_DOWN);
   g_assert_false (mapped_event->button.pressed);
 
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
-
-  mapped_events = manette_map_absolute_event (mapping, 1, -1.0);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 2);
+  n_mapped_events = manette_map_absolute_event (mapping, NULL, 1, -1.0,
+                                                mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 2);
 
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_UP);
   g_assert_true (mapped_event->button.pressed);
 
-  mapped_event = mapped_events->next->data;
+  mapped_event = &mapped_events[1];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpuint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_DOWN);
   g_assert_false (mapped_event->button.pressed);
 
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
+  n_mapped_events = manette_map_absolute_event (mapping, NULL, 1, 1.0,
+                                                mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 2);
 
-  mapped_events = manette_map_absolute_event (mapping, 1, 1.0);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 2);
-
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpuint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_UP);
   g_assert_false (mapped_event->button.pressed);
 
-  mapped_event = mapped_events->next->data;
+  mapped_event = &mapped_events[1];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
   g_assert_cmpuint (mapped_event->button.button, ==, MANETTE_BUTTON_DPAD_DOWN);
   g_assert_true (mapped_event->button.pressed);
-
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
 }
 
 static void
 test_axis_trigger_mapping (void)
 {
   g_autoptr (ManetteMapping) mapping = NULL;
-  GSList *mapped_events;
+  ManetteMappedEvent mapped_events[MANETTE_MAX_MAPPED_EVENTS];
+  gsize n_mapped_events;
   ManetteMappedEvent *mapped_event;
   GError *error = NULL;
 
@@ -289,45 +289,256 @@ test_axis_trigger_mapping (void)
   g_assert_nonnull (mapping);
   g_assert_true (MANETTE_IS_MAPPING (mapping));
 
-  mapped_events = manette_map_absolute_event (mapping, 0, 1.0);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 1);
+  n_mapped_events = manette_map_absolute_event (mapping, NULL, 0, 1.0,
+                                                mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 1);
 
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_AXIS);
   g_assert_cmpint (mapped_event->axis.axis, ==, MANETTE_AXIS_LEFT_TRIGGER);
   g_assert_cmpfloat (mapped_event->axis.value, ==, 1.0);
 
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
+  n_mapped_events = manette_map_absolute_event (mapping, NULL, 0, -1.0,
+                                                mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 1);
 
-  mapped_events = manette_map_absolute_event (mapping, 0, -1.0);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 1);
-
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_AXIS);
   g_assert_cmpint (mapped_event->axis.axis, ==, MANETTE_AXIS_LEFT_TRIGGER);
   g_assert_cmpfloat (mapped_event->axis.value, ==, 0.0);
 
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
-
-  mapped_events = manette_map_absolute_event (mapping, 1, 1.0);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 1);
+  n_mapped_events = manette_map_absolute_event (mapping, NULL, 1, 1.0,
+                                                mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 1);
 
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_AXIS);
   g_assert_cmpint (mapped_event->button.button, ==, MANETTE_AXIS_RIGHT_TRIGGER);
   g_assert_cmpfloat (mapped_event->axis.value, ==, 1.0);
 
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
+  n_mapped_events = manette_map_absolute_event (mapping, NULL, 1, -1.0,
+                                                mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 1);
 
-  mapped_events = manette_map_absolute_event (mapping, 1, -1.0);
-  g_assert_cmpint (g_slist_length (mapped_events), ==, 1);
-
-  mapped_event = mapped_events->data;
+  mapped_event = &mapped_events[0];
   g_assert_cmpint (mapped_event->type, ==, MANETTE_MAPPING_DESTINATION_TYPE_AXIS);
   g_assert_cmpint (mapped_event->button.button, ==, MANETTE_AXIS_RIGHT_TRIGGER);
   g_assert_cmpfloat (mapped_event->axis.value, ==, 0.0);
+}
+
+static void
+test_held_trigger_state (void)
+{
+  g_autoptr (ManetteMapping) mapping = NULL;
+  ManetteMappingState state = {};
+  ManetteMappedEvent mapped_events[MANETTE_MAX_MAPPED_EVENTS];
+  gsize n_mapped_events;
+  guint n_pressed = 0;
+  guint n_released = 0;
+  GError *error = NULL;
+  int i;
+
+  mapping = manette_mapping_new (MAPPING_TRIGGER_BUTTON, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (mapping);
+  g_assert_true (MANETTE_IS_MAPPING (mapping));
+
+  /* Pull the trigger, hold it, then let it go */
+  for (i = -100; i <= 300; i++) {
+    double value = i <= 100 ? i / 100.0 :
+                   i <= 200 ? 1.0 :
+                   (300 - i) / 50.0 - 1.0;
+    gsize j;
+
+    n_mapped_events = manette_map_absolute_event (mapping, &state, 0, value,
+                                                  mapped_events, G_N_ELEMENTS (mapped_events));
+
+    for (j = 0; j < n_mapped_events; j++) {
+      g_assert_cmpint (mapped_events[j].type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
+      g_assert_cmpint (mapped_events[j].button.button, ==, MANETTE_BUTTON_LEFT_SHOULDER);
+
+      if (mapped_events[j].button.pressed)
+        n_pressed++;
+      else
+        n_released++;
+    }
+  }
+
+  g_assert_cmpuint (n_pressed, ==, 1);
+  g_assert_cmpuint (n_released, ==, 1);
+}
+
+static void
+test_hat_state (void)
+{
+  g_autoptr (ManetteMapping) mapping = NULL;
+  ManetteMappingState state = {};
+  ManetteMappedEvent mapped_events[MANETTE_MAX_MAPPED_EVENTS];
+  gsize n_mapped_events;
+  GError *error = NULL;
 
-  g_slist_free_full (mapped_events, (GDestroyNotify) g_free);
+  mapping = manette_mapping_new (MAPPING_HAT, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (mapping);
+  g_assert_true (MANETTE_IS_MAPPING (mapping));
+
+  /* Nothing is pressed yet, so the centered hat has nothing to report */
+  n_mapped_events = manette_map_hat_event (mapping, &state, 0, 0,
+                                           mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 0);
+
+  n_mapped_events = manette_map_hat_event (mapping, &state, 0, -1,
+                                           mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 1);
+  g_assert_cmpint (mapped_events[0].button.button, ==, MANETTE_BUTTON_DPAD_LEFT);
+  g_assert_true (mapped_events[0].button.pressed);
+
+  n_mapped_events = manette_map_hat_event (mapping, &state, 0, -1,
+                                           mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 0);
+
+  /* Skipping the neutral point releases the opposite direction */
+  n_mapped_events = manette_map_hat_event (mapping, &state, 0, 1,
+                                           mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 2);
+  g_assert_cmpint (mapped_events[0].button.button, ==, MANETTE_BUTTON_DPAD_LEFT);
+  g_assert_false (mapped_events[0].button.pressed);
+  g_assert_cmpint (mapped_events[1].button.button, ==, MANETTE_BUTTON_DPAD_RIGHT);
+  g_assert_true (mapped_events[1].button.pressed);
+
+  n_mapped_events = manette_map_hat_event (mapping, &state, 0, 0,
+                                           mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 1);
+  g_assert_cmpint (mapped_events[0].button.button, ==, MANETTE_BUTTON_DPAD_RIGHT);
+  g_assert_false (mapped_events[0].button.pressed);
+}
+
+static void
+test_shared_destination_state (void)
+{
+  g_autoptr (ManetteMapping) mapping = NULL;
+  ManetteMappingState state = {};
+  ManetteMappedEvent mapped_events[MANETTE_MAX_MAPPED_EVENTS];
+  gsize n_mapped_events;
+  GError *error = NULL;
+
+  mapping = manette_mapping_new (MAPPING_SHARED_BUTTON, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (mapping);
+
+  n_mapped_events = manette_map_button_event (mapping, &state, 0, TRUE,
+                                              mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 1);
+  g_assert_cmpint (mapped_events[0].button.button, ==, MANETTE_BUTTON_LEFT_SHOULDER);
+  g_assert_true (mapped_events[0].button.pressed);
+
+  /* The released axis doesn't release what the button holds */
+  n_mapped_events = manette_map_absolute_event (mapping, &state, 0, -1,
+                                                mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 0);
+
+  /* And the button doesn't hide the transitions of the axis */
+  n_mapped_events = manette_map_absolute_event (mapping, &state, 0, 1,
+                                                mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 1);
+  g_assert_true (mapped_events[0].button.pressed);
+
+  g_assert_cmpuint (manette_mapping_state_get_pressed_buttons (&state, mapping), ==,
+                    G_GUINT64_CONSTANT (1) << MANETTE_BUTTON_LEFT_SHOULDER);
+
+  n_mapped_events = manette_map_button_event (mapping, &state, 0, FALSE,
+                                              mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 1);
+  g_assert_false (mapped_events[0].button.pressed);
+
+  n_mapped_events = manette_map_absolute_event (mapping, &state, 0, -1,
+                                                mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 1);
+  g_assert_false (mapped_events[0].button.pressed);
+
+  g_assert_cmpuint (manette_mapping_state_get_pressed_buttons (&state, mapping), ==, 0);
+}
+
+static void
+test_truncated_mapping (void)
+{
+  g_autoptr (ManetteMapping) mapping = NULL;
+  ManetteMappedEvent mapped_events[1];
+  gsize n_mapped_events;
+  GError *error = NULL;
+
+  mapping = manette_mapping_new (MAPPING_HAT, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (mapping);
+  g_assert_true (MANETTE_IS_MAPPING (mapping));
+
+  /* The hat is bound twice, only the first binding fits */
+  n_mapped_events = manette_map_hat_event (mapping, NULL, 0, -1,
+                                           mapped_events, G_N_ELEMENTS (mapped_events));
+  g_assert_cmpuint (n_mapped_events, ==, 1);
+  g_assert_cmpint (mapped_events[0].type, ==, MANETTE_MAPPING_DESTINATION_TYPE_BUTTON);
+  g_assert_cmpint (mapped_events[0].button.button, ==, MANETTE_BUTTON_DPAD_LEFT);
+  g_assert_true (mapped_events[0].button.pressed);
+
+  n_mapped_events = manette_map_hat_event (mapping, NULL, 0, -1, mapped_events, 0);
+  g_assert_cmpuint (n_mapped_events, ==, 0);
+
+  /* A buffer sized for the mapping fits them all */
+  g_assert_cmpuint (manette_mapping_get_max_bindings_per_input (mapping), ==, 2);
+}
+
+static void
+test_mapping_allocations_perf (void)
+{
+  g_autoptr (ManetteMapping) button_mapping = NULL;
+  g_autoptr (ManetteMapping) axis_mapping = NULL;
+  g_autoptr (ManetteMapping) hat_mapping = NULL;
+  ManetteMappedEvent mapped_events[MANETTE_MAX_MAPPED_EVENTS];
+  gsize n_mapped_events = 0;
+  double elapsed;
+  guint n_start;
+  double allocations_per_event;
+  guint i;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("Performance tests not enabled, use -m perf");
+
+    return;
+  }
+
+  if (!manette_test_heap_can_count_allocations ()) {
+    g_test_skip ("Counting allocations is disabled, see the alloc-counting option");
+
+    return;
+  }
+
+  button_mapping = manette_mapping_new (MAPPING_BUTTON, NULL);
+  axis_mapping = manette_mapping_new (MAPPING_AXIS, NULL);
+  hat_mapping = manette_mapping_new (MAPPING_HAT, NULL);
+
+  n_start = manette_test_heap_get_n_allocations ();
+  g_test_timer_start ();
+  for (i = 0; i < N_EVENTS; i++) {
+    n_mapped_events += manette_map_button_event (button_mapping, NULL, i % 4, i % 2,
+                                                 mapped_events, G_N_ELEMENTS (mapped_events));
+    n_mapped_events += manette_map_absolute_event (axis_mapping, NULL, i % 4, (i % 3) - 1.0,
+                                                   mapped_events, G_N_ELEMENTS (mapped_events));
+    n_mapped_events += manette_map_hat_event (hat_mapping, NULL, i % 2, (i % 3) - 1,
+                                              mapped_events, G_N_ELEMENTS (mapped_events));
+  }
+  elapsed = g_test_timer_elapsed ();
+  allocations_per_event = (double) (manette_test_heap_get_n_allocations () - n_start) / (N_EVENTS * 3);
+
+  g_assert_cmpuint (n_mapped_events, >, 0);
+
+  g_test_minimized_result (allocations_per_event,
+                           "Allocations per event: %g",
+                           allocations_per_event);
+  g_test_minimized_result (elapsed / (N_EVENTS * 3) * 1e9,
+                           "Mapping an event: %.1f ns",
+                           elapsed / (N_EVENTS * 3) * 1e9);
+
+  g_assert_cmpfloat (allocations_per_event, ==, 0);
 }
 
 int
@@ -343,6 +554,11 @@ main (int   argc,
   g_test_add_func ("/ManetteEventMapping/test_hat_mapping", test_hat_mapping);
   g_test_add_func ("/ManetteEventMapping/test_axis_dpad_mapping", test_axis_dpad_mapping);
   g_test_add_func ("/ManetteEventMapping/test_axis_trigger_mapping", test_axis_trigger_mapping);
+  g_test_add_func ("/ManetteEventMapping/test_held_trigger_state", test_held_trigger_state);
+  g_test_add_func ("/ManetteEventMapping/test_hat_state", test_hat_state);
+  g_test_add_func ("/ManetteEventMapping/test_shared_destination_state", test_shared_destination_state);
+  g_test_add_func ("/ManetteEventMapping/test_truncated_mapping", test_truncated_mapping);
+  g_test_add_func ("/ManetteEventMapping/test_mapping_allocations_perf", test_mapping_allocations_perf);
 
   return g_test_run();
 }
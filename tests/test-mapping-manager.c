@@ -19,6 +19,13 @@
 #include "../src/manette-mapping-manager-private.h"
 #include "../src/manette-mapping-private.h"
 
+#include "manette-test-heap.h"
+
+#define GUID_STEAM_CONTROLLER "03000000de280000fc11000001000000"
+#define N_LOOKUPS 100
+#define N_SAVES 10
+#define TIMEOUT_MS 10000
+
 static void
 test_valid (void)
 {
@@ -55,14 +62,331 @@ test_default_mappings (void)
   }
 }
 
+static void
+test_default_mapping (void)
+{
+  g_autoptr (ManetteMappingManager) mapping_manager = NULL;
+  g_autofree char *mapping = NULL;
+  g_autofree char *unknown_mapping = NULL;
+  g_autofree char *invalid_mapping = NULL;
+
+  mapping_manager = manette_mapping_manager_new ();
+
+  mapping = manette_mapping_manager_get_default_mapping (mapping_manager,
+                                                         GUID_STEAM_CONTROLLER);
+  g_assert_nonnull (mapping);
+  g_assert_true (g_str_has_prefix (mapping, GUID_STEAM_CONTROLLER ",Steam Controller,"));
+
+  unknown_mapping = manette_mapping_manager_get_default_mapping (mapping_manager,
+                                                                 "ffffffffffffffffffffffffffffffff");
+  g_assert_null (unknown_mapping);
+
+  invalid_mapping = manette_mapping_manager_get_default_mapping (mapping_manager,
+                                                                 "03000000de28");
+  g_assert_null (invalid_mapping);
+}
+
+static void
+test_default (void)
+{
+  g_autoptr (ManetteMappingManager) mapping_manager = NULL;
+  g_autoptr (ManetteMappingManager) other_mapping_manager = NULL;
+
+  mapping_manager = manette_mapping_manager_dup_default ();
+  g_assert_nonnull (mapping_manager);
+  g_assert_true (MANETTE_IS_MAPPING_MANAGER (mapping_manager));
+
+  other_mapping_manager = manette_mapping_manager_dup_default ();
+  g_assert_true (mapping_manager == other_mapping_manager);
+}
+
+static void
+test_default_lookup_perf (void)
+{
+  g_autoptr (ManetteMappingManager) shared_manager = NULL;
+  double new_elapsed, shared_elapsed;
+  guint i;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("Performance tests not enabled, use -m perf");
+
+    return;
+  }
+
+  /* What looking up a mapping costed before the manager was shared: a full
+   * database parse per lookup.
+   */
+  g_test_timer_start ();
+  for (i = 0; i < N_LOOKUPS; i++) {
+    g_autoptr (ManetteMappingManager) mapping_manager = manette_mapping_manager_new ();
+    g_autofree char *mapping = manette_mapping_manager_get_mapping (mapping_manager,
+                                                                    GUID_STEAM_CONTROLLER);
+
+    g_assert_nonnull (mapping);
+  }
+  new_elapsed = g_test_timer_elapsed ();
+
+  shared_manager = manette_mapping_manager_dup_default ();
+
+  g_test_timer_start ();
+  for (i = 0; i < N_LOOKUPS; i++) {
+    g_autoptr (ManetteMappingManager) mapping_manager = manette_mapping_manager_dup_default ();
+    g_autofree char *mapping = manette_mapping_manager_get_mapping (mapping_manager,
+                                                                    GUID_STEAM_CONTROLLER);
+
+    g_assert_nonnull (mapping);
+  }
+  shared_elapsed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (new_elapsed / N_LOOKUPS * G_USEC_PER_SEC,
+                           "Lookup with a new manager: %.2f µs",
+                           new_elapsed / N_LOOKUPS * G_USEC_PER_SEC);
+  g_test_minimized_result (shared_elapsed / N_LOOKUPS * G_USEC_PER_SEC,
+                           "Lookup with the shared manager: %.2f µs",
+                           shared_elapsed / N_LOOKUPS * G_USEC_PER_SEC);
+}
+
+typedef gboolean (*ConditionFunc) (gconstpointer data);
+
+static gboolean
+timeout_cb (gboolean *timed_out)
+{
+  *timed_out = TRUE;
+
+  return G_SOURCE_REMOVE;
+}
+
+/* Iterates the default context until @condition is met, e.g. to let the
+ * debounced saves and reloads, and the file monitor, run.
+ */
+static void
+wait_for (ConditionFunc condition,
+          gconstpointer data)
+{
+  gboolean timed_out = FALSE;
+  guint timeout_id;
+
+  timeout_id = g_timeout_add (TIMEOUT_MS, (GSourceFunc) timeout_cb, &timed_out);
+
+  while (!condition (data) && !timed_out)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_false (timed_out);
+  g_source_remove (timeout_id);
+}
+
+static gboolean
+is_finalized (gconstpointer data)
+{
+  return *(gpointer const *) data == NULL;
+}
+
+/* The pending saves and reloads keep the manager alive, let them run so they
+ * don't leak into the next test.
+ */
+static void
+unref_and_wait (ManetteMappingManager *mapping_manager)
+{
+  g_object_add_weak_pointer (G_OBJECT (mapping_manager), (gpointer *) &mapping_manager);
+  g_object_unref (mapping_manager);
+  wait_for (is_finalized, &mapping_manager);
+}
+
+typedef struct {
+  const char *path;
+  const char *contents;
+} FileContents;
+
+static gboolean
+has_contents (gconstpointer data)
+{
+  const FileContents *expected = data;
+  g_autofree char *contents = NULL;
+
+  if (!g_file_get_contents (expected->path, &contents, NULL, NULL))
+    return FALSE;
+
+  return g_strcmp0 (contents, expected->contents) == 0;
+}
+
+typedef struct {
+  GPtrArray *changed;
+  guint n_changed;
+} ChangedCount;
+
+static gboolean
+has_changed (gconstpointer data)
+{
+  const ChangedCount *expected = data;
+
+  return expected->changed->len >= expected->n_changed;
+}
+
+static void
+changed_cb (ManetteMappingManager *mapping_manager,
+            const char            *guid,
+            GPtrArray             *changed)
+{
+  g_ptr_array_add (changed, g_strdup (guid));
+}
+
+static void
+test_save_mapping (void)
+{
+  ManetteMappingManager *mapping_manager;
+  g_autoptr (GPtrArray) changed = g_ptr_array_new_with_free_func (g_free);
+  g_autofree char *path = NULL;
+  g_autofree char *contents = NULL;
+  g_autofree char *mapping = NULL;
+  g_autoptr (GError) error = NULL;
+
+  path = g_build_filename (g_get_user_config_dir (), "libmanette", "gamecontrollerdb", NULL);
+
+  mapping_manager = manette_mapping_manager_new ();
+  g_signal_connect (mapping_manager, "changed", G_CALLBACK (changed_cb), changed);
+
+  manette_mapping_manager_save_mapping (mapping_manager,
+                                        GUID_STEAM_CONTROLLER,
+                                        "Steam Controller",
+                                        "a:b1,b:b0,");
+  g_assert_cmpuint (changed->len, ==, 1);
+  g_assert_cmpstr (g_ptr_array_index (changed, 0), ==, GUID_STEAM_CONTROLLER);
+
+  g_assert_true (manette_mapping_manager_has_user_mapping (mapping_manager,
+                                                           GUID_STEAM_CONTROLLER));
+  mapping = manette_mapping_manager_get_mapping (mapping_manager,
+                                                 GUID_STEAM_CONTROLLER);
+  g_assert_cmpstr (mapping, ==, GUID_STEAM_CONTROLLER ",Steam Controller,a:b1,b:b0,");
+
+  /* A single save is written right away, without iterating the context */
+  g_file_get_contents (path, &contents, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (contents, ==, GUID_STEAM_CONTROLLER ",Steam Controller,a:b1,b:b0,\n");
+
+  manette_mapping_manager_delete_mapping (mapping_manager, GUID_STEAM_CONTROLLER);
+  g_assert_cmpuint (changed->len, ==, 2);
+  g_assert_cmpstr (g_ptr_array_index (changed, 1), ==, GUID_STEAM_CONTROLLER);
+  g_assert_false (manette_mapping_manager_has_user_mapping (mapping_manager,
+                                                            GUID_STEAM_CONTROLLER));
+
+  /* The deletion following the save is written once the burst is over */
+  g_signal_handlers_disconnect_by_data (mapping_manager, changed);
+  unref_and_wait (mapping_manager);
+
+  g_clear_pointer (&contents, g_free);
+  g_file_get_contents (path, &contents, NULL, &error);
+  g_assert_no_error (error);
+  g_assert_cmpstr (contents, ==, "");
+}
+
+static void
+test_save_reloads (void)
+{
+  ManetteMappingManager *mapping_manager;
+  g_autoptr (GPtrArray) changed = g_ptr_array_new_with_free_func (g_free);
+  g_autofree char *directory = NULL;
+  g_autofree char *path = NULL;
+  g_autofree char *mapping = NULL;
+  g_autoptr (GError) error = NULL;
+  FileContents saved;
+  ChangedCount reloaded;
+  guint i;
+
+  /* Monitoring a file in a missing directory falls back to polling */
+  directory = g_build_filename (g_get_user_config_dir (), "libmanette", NULL);
+  path = g_build_filename (directory, "gamecontrollerdb", NULL);
+  g_assert_cmpint (g_mkdir_with_parents (directory, 0755), ==, 0);
+
+  mapping_manager = manette_mapping_manager_new ();
+  g_signal_connect (mapping_manager, "changed", G_CALLBACK (changed_cb), changed);
+
+  /* A burst of saves ends up on disk. Reloading the intermediate writes would
+   * notify about the mapping changing back.
+   */
+  for (i = 0; i < N_SAVES; i++)
+    manette_mapping_manager_save_mapping (mapping_manager,
+                                          GUID_STEAM_CONTROLLER,
+                                          "Steam Controller",
+                                          i % 2 ? "a:b1,b:b0," : "a:b0,b:b1,");
+
+  saved.path = path;
+  saved.contents = GUID_STEAM_CONTROLLER ",Steam Controller,a:b1,b:b0,\n";
+  wait_for (has_contents, &saved);
+
+  g_assert_cmpuint (changed->len, ==, N_SAVES);
+
+  /* Someone else's write is reloaded */
+  g_file_set_contents (path, GUID_STEAM_CONTROLLER ",Steam Controller,a:b2,b:b3,\n", -1, &error);
+  g_assert_no_error (error);
+
+  reloaded.changed = changed;
+  reloaded.n_changed = N_SAVES + 1;
+  wait_for (has_changed, &reloaded);
+
+  g_assert_cmpuint (changed->len, ==, N_SAVES + 1);
+  mapping = manette_mapping_manager_get_mapping (mapping_manager, GUID_STEAM_CONTROLLER);
+  g_assert_cmpstr (mapping, ==, GUID_STEAM_CONTROLLER ",Steam Controller,a:b2,b:b3,");
+
+  g_signal_handlers_disconnect_by_data (mapping_manager, changed);
+  unref_and_wait (mapping_manager);
+}
+
+static void
+test_startup_perf (void)
+{
+  double elapsed;
+  gsize heap;
+  guint i;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("Performance tests not enabled, use -m perf");
+
+    return;
+  }
+
+  g_test_timer_start ();
+  for (i = 0; i < N_LOOKUPS; i++) {
+    g_autoptr (ManetteMappingManager) mapping_manager = manette_mapping_manager_new ();
+    g_autofree char *mapping = manette_mapping_manager_get_mapping (mapping_manager,
+                                                                    GUID_STEAM_CONTROLLER);
+
+    g_assert_nonnull (mapping);
+  }
+  elapsed = g_test_timer_elapsed ();
+
+  {
+    g_autoptr (ManetteMappingManager) mapping_manager = NULL;
+
+    heap = manette_test_heap_get_size ();
+    mapping_manager = manette_mapping_manager_new ();
+    heap = manette_test_heap_get_size () - heap;
+  }
+
+  g_test_minimized_result (elapsed / N_LOOKUPS * G_USEC_PER_SEC,
+                           "Startup and first lookup: %.2f µs",
+                           elapsed / N_LOOKUPS * G_USEC_PER_SEC);
+
+  if (manette_test_heap_can_get_size ())
+    g_test_minimized_result (heap,
+                             "Heap used by the database: %" G_GSIZE_FORMAT " bytes",
+                             heap);
+}
+
 int
 main (int   argc,
       char *argv[])
 {
-  g_test_init (&argc, &argv, NULL);
+  /* Don't touch the actual user mappings */
+  g_test_init (&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
 
   g_test_add_func ("/ManetteMappingManager/test_valid", test_valid);
   g_test_add_func ("/ManetteMappingManager/test_default_mappings", test_default_mappings);
+  g_test_add_func ("/ManetteMappingManager/test_default_mapping", test_default_mapping);
+  g_test_add_func ("/ManetteMappingManager/test_default", test_default);
+  g_test_add_func ("/ManetteMappingManager/test_save_mapping", test_save_mapping);
+  g_test_add_func ("/ManetteMappingManager/test_save_reloads", test_save_reloads);
+  g_test_add_func ("/ManetteMappingManager/test_default_lookup_perf", test_default_lookup_perf);
+  g_test_add_func ("/ManetteMappingManager/test_startup_perf", test_startup_perf);
 
   return g_test_run();
 }
@@ -16,12 +16,18 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include "../src/manette-mapping-manager-private.h"
 #include "../src/manette-mapping-private.h"
 
+#include "manette-test-heap.h"
+
 #define MAPPING_STEAM_CONTROLLER "03000000de280000fc11000001000000,Steam Controller,a:b0,b:b1,back:b6,dpdown:h0.4,dpleft:h0.8,dpright:h0.2,dpup:h0.1,guide:b8,leftshoulder:b4,leftstick:b9,lefttrigger:a2,leftx:a0,lefty:a1,rightshoulder:b5,rightstick:b10,righttrigger:a5,rightx:a3,righty:a4,start:b7,x:b2,y:b3,"
 #define MAPPING_BUTTON "00000000000000000000000000000000,button,a:b0,b:b1,x:b2,y:b3,"
 #define MAPPING_AXIS "00000000000000000000000000000000,axis,leftx:a0,lefty:a1,-rightx:-a2,+rightx:+a2,-righty:+a3~,+righty:-a3~,"
 #define MAPPING_HAT "00000000000000000000000000000000,hat,dpleft:h0.8,dpright:h0.2,dpup:h0.1,dpdown:h0.4,"
+#define MAPPING_EMPTY "00000000000000000000000000000000,empty,"
+#define N_PARSE_ROUNDS 10
+#define N_ITERATION_ROUNDS 100
 
 static void
 test_null (void)
@@ -67,8 +73,9 @@ static void
 test_button_bindings (void)
 {
   g_autoptr (ManetteMapping) mapping = NULL;
-  const ManetteMappingBinding * const *bindings;
+  const ManetteMappingBinding *bindings;
   const ManetteMappingBinding *binding;
+  gsize n_bindings;
   GError *error = NULL;
 
   mapping = manette_mapping_new (MAPPING_BUTTON, &error);
@@ -78,13 +85,12 @@ test_button_bindings (void)
 
   bindings = manette_mapping_get_bindings (mapping,
                                            MANETTE_MAPPING_INPUT_TYPE_BUTTON,
-                                           0);
+                                           0, &n_bindings);
 
   g_assert_nonnull (bindings);
-  g_assert_nonnull (bindings[0]);
-  g_assert_null (bindings[1]);
+  g_assert_cmpuint (n_bindings, ==, 1);
 
-  binding = bindings[0];
+  binding = &bindings[0];
   g_assert_cmpint (binding->source.type, ==, MANETTE_MAPPING_INPUT_TYPE_BUTTON);
   g_assert_cmpint (binding->source.index, ==, 0);
   g_assert_cmpint (binding->source.range, ==, MANETTE_MAPPING_RANGE_FULL);
@@ -95,13 +101,12 @@ test_button_bindings (void)
 
   bindings = manette_mapping_get_bindings (mapping,
                                            MANETTE_MAPPING_INPUT_TYPE_BUTTON,
-                                           1);
+                                           1, &n_bindings);
 
   g_assert_nonnull (bindings);
-  g_assert_nonnull (bindings[0]);
-  g_assert_null (bindings[1]);
+  g_assert_cmpuint (n_bindings, ==, 1);
 
-  binding = bindings[0];
+  binding = &bindings[0];
   g_assert_cmpint (binding->source.type, ==, MANETTE_MAPPING_INPUT_TYPE_BUTTON);
   g_assert_cmpint (binding->source.index, ==, 1);
   g_assert_cmpint (binding->source.range, ==, MANETTE_MAPPING_RANGE_FULL);
@@ -112,13 +117,12 @@ test_button_bindings (void)
 
   bindings = manette_mapping_get_bindings (mapping,
                                            MANETTE_MAPPING_INPUT_TYPE_BUTTON,
-                                           2);
+                                           2, &n_bindings);
 
   g_assert_nonnull (bindings);
-  g_assert_nonnull (bindings[0]);
-  g_assert_null (bindings[1]);
+  g_assert_cmpuint (n_bindings, ==, 1);
 
-  binding = bindings[0];
+  binding = &bindings[0];
   g_assert_cmpint (binding->source.type, ==, MANETTE_MAPPING_INPUT_TYPE_BUTTON);
   g_assert_cmpint (binding->source.index, ==, 2);
   g_assert_cmpint (binding->source.range, ==, MANETTE_MAPPING_RANGE_FULL);
@@ -129,13 +133,12 @@ test_button_bindings (void)
 
   bindings = manette_mapping_get_bindings (mapping,
                                            MANETTE_MAPPING_INPUT_TYPE_BUTTON,
-                                           3);
+                                           3, &n_bindings);
 
   g_assert_nonnull (bindings);
-  g_assert_nonnull (bindings[0]);
-  g_assert_null (bindings[1]);
+  g_assert_cmpuint (n_bindings, ==, 1);
 
-  binding = bindings[0];
+  binding = &bindings[0];
   g_assert_cmpint (binding->source.type, ==, MANETTE_MAPPING_INPUT_TYPE_BUTTON);
   g_assert_cmpint (binding->source.index, ==, 3);
   g_assert_cmpint (binding->source.range, ==, MANETTE_MAPPING_RANGE_FULL);
@@ -149,8 +152,9 @@ static void
 test_axis_bindings (void)
 {
   g_autoptr (ManetteMapping) mapping = NULL;
-  const ManetteMappingBinding * const *bindings;
+  const ManetteMappingBinding *bindings;
   const ManetteMappingBinding *binding;
+  gsize n_bindings;
   GError *error = NULL;
 
   mapping = manette_mapping_new (MAPPING_AXIS, &error);
@@ -160,13 +164,12 @@ test_axis_bindings (void)
 
   bindings = manette_mapping_get_bindings (mapping,
                                            MANETTE_MAPPING_INPUT_TYPE_AXIS,
-                                           0);
+                                           0, &n_bindings);
 
   g_assert_nonnull (bindings);
-  g_assert_nonnull (bindings[0]);
-  g_assert_null (bindings[1]);
+  g_assert_cmpuint (n_bindings, ==, 1);
 
-  binding = bindings[0];
+  binding = &bindings[0];
   g_assert_cmpint (binding->source.type, ==, MANETTE_MAPPING_INPUT_TYPE_AXIS);
   g_assert_cmpint (binding->source.index, ==, 0);
   g_assert_cmpint (binding->source.range, ==, MANETTE_MAPPING_RANGE_FULL);
@@ -177,13 +180,12 @@ test_axis_bindings (void)
 
   bindings = manette_mapping_get_bindings (mapping,
                                            MANETTE_MAPPING_INPUT_TYPE_AXIS,
-                                           1);
+                                           1, &n_bindings);
 
   g_assert_nonnull (bindings);
-  g_assert_nonnull (bindings[0]);
-  g_assert_null (bindings[1]);
+  g_assert_cmpuint (n_bindings, ==, 1);
 
-  binding = bindings[0];
+  binding = &bindings[0];
   g_assert_cmpint (binding->source.type, ==, MANETTE_MAPPING_INPUT_TYPE_AXIS);
   g_assert_cmpint (binding->source.index, ==, 1);
   g_assert_cmpint (binding->source.range, ==, MANETTE_MAPPING_RANGE_FULL);
@@ -197,8 +199,9 @@ static void
 test_axis_range_bindings (void)
 {
   g_autoptr (ManetteMapping) mapping = NULL;
-  const ManetteMappingBinding * const *bindings;
+  const ManetteMappingBinding *bindings;
   const ManetteMappingBinding *binding;
+  gsize n_bindings;
   GError *error = NULL;
 
   mapping = manette_mapping_new (MAPPING_AXIS, &error);
@@ -208,14 +211,12 @@ test_axis_range_bindings (void)
 
   bindings = manette_mapping_get_bindings (mapping,
                                            MANETTE_MAPPING_INPUT_TYPE_AXIS,
-                                           2);
+                                           2, &n_bindings);
 
   g_assert_nonnull (bindings);
-  g_assert_nonnull (bindings[0]);
-  g_assert_nonnull (bindings[1]);
-  g_assert_null (bindings[2]);
+  g_assert_cmpuint (n_bindings, ==, 2);
 
-  binding = bindings[0];
+  binding = &bindings[0];
   g_assert_cmpint (binding->source.type, ==, MANETTE_MAPPING_INPUT_TYPE_AXIS);
   g_assert_cmpint (binding->source.index, ==, 2);
   g_assert_cmpint (binding->source.range, ==, MANETTE_MAPPING_RANGE_NEGATIVE);
@@ -224,7 +225,7 @@ test_axis_range_bindings (void)
   g_assert_cmpint (binding->destination.code, ==, MANETTE_AXIS_RIGHT_X);
   g_assert_cmpint (binding->destination.range, ==, MANETTE_MAPPING_RANGE_NEGATIVE);
 
-  binding = bindings[1];
+  binding = &bindings[1];
   g_assert_cmpint (binding->source.type, ==, MANETTE_MAPPING_INPUT_TYPE_AXIS);
   g_assert_cmpint (binding->source.index, ==, 2);
   g_assert_cmpint (binding->source.range, ==, MANETTE_MAPPING_RANGE_POSITIVE);
@@ -235,14 +236,12 @@ test_axis_range_bindings (void)
 
   bindings = manette_mapping_get_bindings (mapping,
                                            MANETTE_MAPPING_INPUT_TYPE_AXIS,
-                                           3);
+                                           3, &n_bindings);
 
   g_assert_nonnull (bindings);
-  g_assert_nonnull (bindings[0]);
-  g_assert_nonnull (bindings[1]);
-  g_assert_null (bindings[2]);
+  g_assert_cmpuint (n_bindings, ==, 2);
 
-  binding = bindings[0];
+  binding = &bindings[0];
   g_assert_cmpint (binding->source.type, ==, MANETTE_MAPPING_INPUT_TYPE_AXIS);
   g_assert_cmpint (binding->source.index, ==, 3);
   g_assert_cmpint (binding->source.range, ==, MANETTE_MAPPING_RANGE_POSITIVE);
@@ -251,7 +250,7 @@ test_axis_range_bindings (void)
   g_assert_cmpint (binding->destination.code, ==, MANETTE_AXIS_RIGHT_Y);
   g_assert_cmpint (binding->destination.range, ==, MANETTE_MAPPING_RANGE_NEGATIVE);
 
-  binding = bindings[1];
+  binding = &bindings[1];
   g_assert_cmpint (binding->source.type, ==, MANETTE_MAPPING_INPUT_TYPE_AXIS);
   g_assert_cmpint (binding->source.index, ==, 3);
   g_assert_cmpint (binding->source.range, ==, MANETTE_MAPPING_RANGE_NEGATIVE);
@@ -265,8 +264,9 @@ static void
 test_hat_x_bindings (void)
 {
   g_autoptr (ManetteMapping) mapping = NULL;
-  const ManetteMappingBinding * const *bindings;
+  const ManetteMappingBinding *bindings;
   const ManetteMappingBinding *binding;
+  gsize n_bindings;
   GError *error = NULL;
 
   mapping = manette_mapping_new (MAPPING_HAT, &error);
@@ -276,14 +276,12 @@ test_hat_x_bindings (void)
 
   bindings = manette_mapping_get_bindings (mapping,
                                            MANETTE_MAPPING_INPUT_TYPE_HAT,
-                                           0);
+                                           0, &n_bindings);
 
   g_assert_nonnull (bindings);
-  g_assert_nonnull (bindings[0]);
-  g_assert_nonnull (bindings[1]);
-  g_assert_null (bindings[2]);
+  g_assert_cmpuint (n_bindings, ==, 2);
 
-  binding = bindings[0];
+  binding = &bindings[0];
   g_assert_cmpint (binding->source.type, ==, MANETTE_MAPPING_INPUT_TYPE_HAT);
   g_assert_cmpint (binding->source.index, ==, 0);
   g_assert_cmpint (binding->source.range, ==, MANETTE_MAPPING_RANGE_NEGATIVE);
@@ -292,7 +290,7 @@ test_hat_x_bindings (void)
   g_assert_cmpint (binding->destination.code, ==, MANETTE_BUTTON_DPAD_LEFT);
   g_assert_cmpint (binding->destination.range, ==, MANETTE_MAPPING_RANGE_FULL);
 
-  binding = bindings[1];
+  binding = &bindings[1];
   g_assert_cmpint (binding->source.type, ==, MANETTE_MAPPING_INPUT_TYPE_HAT);
   g_assert_cmpint (binding->source.index, ==, 0);
   g_assert_cmpint (binding->source.range, ==, MANETTE_MAPPING_RANGE_POSITIVE);
@@ -306,8 +304,9 @@ static void
 test_hat_y_bindings (void)
 {
   g_autoptr (ManetteMapping) mapping = NULL;
-  const ManetteMappingBinding * const *bindings;
+  const ManetteMappingBinding *bindings;
   const ManetteMappingBinding *binding;
+  gsize n_bindings;
   GError *error = NULL;
 
   mapping = manette_mapping_new (MAPPING_HAT, &error);
@@ -317,14 +316,12 @@ test_hat_y_bindings (void)
 
   bindings = manette_mapping_get_bindings (mapping,
                                            MANETTE_MAPPING_INPUT_TYPE_HAT,
-                                           1);
+                                           1, &n_bindings);
 
   g_assert_nonnull (bindings);
-  g_assert_nonnull (bindings[0]);
-  g_assert_nonnull (bindings[1]);
-  g_assert_null (bindings[2]);
+  g_assert_cmpuint (n_bindings, ==, 2);
 
-  binding = bindings[0];
+  binding = &bindings[0];
   g_assert_cmpint (binding->source.type, ==, MANETTE_MAPPING_INPUT_TYPE_HAT);
   g_assert_cmpint (binding->source.index, ==, 1);
   g_assert_cmpint (binding->source.range, ==, MANETTE_MAPPING_RANGE_NEGATIVE);
@@ -333,7 +330,7 @@ test_hat_y_bindings (void)
   g_assert_cmpint (binding->destination.code, ==, MANETTE_BUTTON_DPAD_UP);
   g_assert_cmpint (binding->destination.range, ==, MANETTE_MAPPING_RANGE_FULL);
 
-  binding = bindings[1];
+  binding = &bindings[1];
   g_assert_cmpint (binding->source.type, ==, MANETTE_MAPPING_INPUT_TYPE_HAT);
   g_assert_cmpint (binding->source.index, ==, 1);
   g_assert_cmpint (binding->source.range, ==, MANETTE_MAPPING_RANGE_POSITIVE);
@@ -378,6 +375,354 @@ test_has_destination_input (void)
   g_assert_true (manette_mapping_has_destination_axis (mapping, MANETTE_AXIS_RIGHT_TRIGGER));
 }
 
+static void
+test_dispatch (void)
+{
+  g_autoptr (ManetteMapping) mapping = NULL;
+  const ManetteMappingDispatchEntry *entries;
+  gsize n_entries;
+  GError *error = NULL;
+
+  mapping = manette_mapping_new (MAPPING_AXIS, &error);
+  g_assert_no_error (error);
+  g_assert_nonnull (mapping);
+  g_assert_true (MANETTE_IS_MAPPING (mapping));
+
+  entries = manette_mapping_get_dispatch (mapping,
+                                          MANETTE_MAPPING_INPUT_TYPE_AXIS,
+                                          0, &n_entries);
+  g_assert_cmpuint (n_entries, ==, 1);
+  g_assert_cmpint (entries[0].type, ==, MANETTE_MAPPING_DESTINATION_TYPE_AXIS);
+  g_assert_cmpint (entries[0].code, ==, MANETTE_AXIS_LEFT_X);
+  g_assert_cmpfloat (entries[0].scale, ==, 1.0);
+  g_assert_cmpfloat (entries[0].offset, ==, 0.0);
+
+  entries = manette_mapping_get_dispatch (mapping,
+                                          MANETTE_MAPPING_INPUT_TYPE_AXIS,
+                                          2, &n_entries);
+  g_assert_cmpuint (n_entries, ==, 2);
+
+  g_assert_cmpint (entries[0].type, ==, MANETTE_MAPPING_DESTINATION_TYPE_AXIS);
+  g_assert_cmpint (entries[0].code, ==, MANETTE_AXIS_RIGHT_X);
+  g_assert_cmpfloat (entries[0].max, ==, 0.0);
+  g_assert_cmpfloat (entries[0].scale, ==, 0.5);
+  g_assert_cmpfloat (entries[0].offset, ==, -0.5);
+
+  g_assert_cmpint (entries[1].type, ==, MANETTE_MAPPING_DESTINATION_TYPE_AXIS);
+  g_assert_cmpint (entries[1].code, ==, MANETTE_AXIS_RIGHT_X);
+  g_assert_cmpfloat (entries[1].min, ==, 0.0);
+  g_assert_cmpfloat (entries[1].scale, ==, 0.5);
+  g_assert_cmpfloat (entries[1].offset, ==, 0.5);
+
+  entries = manette_mapping_get_dispatch (mapping,
+                                          MANETTE_MAPPING_INPUT_TYPE_AXIS,
+                                          3, &n_entries);
+  g_assert_cmpuint (n_entries, ==, 2);
+
+  g_assert_cmpint (entries[0].code, ==, MANETTE_AXIS_RIGHT_Y);
+  g_assert_cmpfloat (entries[0].min, ==, 0.0);
+  g_assert_cmpfloat (entries[0].scale, ==, -0.5);
+  g_assert_cmpfloat (entries[0].offset, ==, -0.5);
+
+  g_assert_cmpint (entries[1].code, ==, MANETTE_AXIS_RIGHT_Y);
+  g_assert_cmpfloat (entries[1].max, ==, 0.0);
+  g_assert_cmpfloat (entries[1].scale, ==, -0.5);
+  g_assert_cmpfloat (entries[1].offset, ==, 0.5);
+
+  manette_mapping_get_dispatch (mapping,
+                                MANETTE_MAPPING_INPUT_TYPE_AXIS,
+                                4, &n_entries);
+  g_assert_cmpuint (n_entries, ==, 0);
+
+  manette_mapping_get_dispatch (mapping,
+                                MANETTE_MAPPING_INPUT_TYPE_BUTTON,
+                                0, &n_entries);
+  g_assert_cmpuint (n_entries, ==, 0);
+}
+
+static void
+test_shared (void)
+{
+  g_autoptr (ManetteMapping) mapping = NULL;
+  g_autoptr (ManetteMapping) same_mapping = NULL;
+  g_autoptr (ManetteMapping) other_mapping = NULL;
+  g_autoptr (ManetteMapping) invalid_mapping = NULL;
+  g_autoptr (GError) error = NULL;
+  GWeakRef weak_ref;
+
+  mapping = manette_mapping_dup_for_string (MAPPING_STEAM_CONTROLLER, &error);
+  g_assert_no_error (error);
+  same_mapping = manette_mapping_dup_for_string (MAPPING_STEAM_CONTROLLER, &error);
+  g_assert_no_error (error);
+  other_mapping = manette_mapping_dup_for_string (MAPPING_BUTTON, &error);
+  g_assert_no_error (error);
+
+  g_assert_true (mapping == same_mapping);
+  g_assert_true (mapping != other_mapping);
+
+  invalid_mapping = manette_mapping_dup_for_string ("", &error);
+  g_assert_error (error,
+                  MANETTE_MAPPING_ERROR,
+                  MANETTE_MAPPING_ERROR_NOT_A_MAPPING);
+  g_assert_null (invalid_mapping);
+
+  /* The mapping isn't kept alive by the cache */
+  g_weak_ref_init (&weak_ref, mapping);
+  g_clear_object (&mapping);
+  g_clear_object (&same_mapping);
+  g_assert_null (g_weak_ref_get (&weak_ref));
+  g_weak_ref_clear (&weak_ref);
+
+  mapping = manette_mapping_dup_for_string (MAPPING_STEAM_CONTROLLER, NULL);
+  g_assert_nonnull (mapping);
+}
+
+static void
+test_parse_perf (void)
+{
+  g_autoptr (ManetteMappingManager) mapping_manager = NULL;
+  g_autoptr (GList) default_mappings = NULL;
+  guint n_entries = 0;
+  guint allocations;
+  double elapsed;
+  guint i;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("Performance tests not enabled, use -m perf");
+
+    return;
+  }
+
+  mapping_manager = manette_mapping_manager_new ();
+  default_mappings = manette_mapping_manager_get_default_mappings (mapping_manager);
+
+  allocations = manette_test_heap_get_n_allocations ();
+  g_test_timer_start ();
+  for (i = 0; i < N_PARSE_ROUNDS; i++) {
+    for (GList *l = default_mappings; l != NULL; l = l->next) {
+      g_autoptr (ManetteMapping) mapping = NULL;
+      g_autoptr (GError) error = NULL;
+
+      mapping = manette_mapping_new (l->data, &error);
+      g_assert_no_error (error);
+      n_entries++;
+    }
+  }
+  elapsed = g_test_timer_elapsed ();
+  allocations = manette_test_heap_get_n_allocations () - allocations;
+
+  g_test_maximized_result (n_entries / elapsed,
+                           "Parsed the database at %.0f entries/s",
+                           n_entries / elapsed);
+  if (manette_test_heap_can_count_allocations ())
+    g_test_minimized_result ((double) allocations / n_entries,
+                             "Allocations per entry: %.2f",
+                             (double) allocations / n_entries);
+}
+
+static GPtrArray *
+parse_default_mappings (void)
+{
+  g_autoptr (ManetteMappingManager) mapping_manager = manette_mapping_manager_new ();
+  g_autoptr (GList) default_mappings = NULL;
+  GPtrArray *mappings = g_ptr_array_new_with_free_func (g_object_unref);
+
+  default_mappings = manette_mapping_manager_get_default_mappings (mapping_manager);
+  for (GList *l = default_mappings; l != NULL; l = l->next)
+    g_ptr_array_add (mappings, manette_mapping_new (l->data, NULL));
+
+  return mappings;
+}
+
+/* The instances alone, to only measure the storage of the bindings */
+static GPtrArray *
+parse_empty_mappings (guint n_mappings)
+{
+  GPtrArray *mappings = g_ptr_array_new_full (n_mappings, g_object_unref);
+  guint i;
+
+  for (i = 0; i < n_mappings; i++)
+    g_ptr_array_add (mappings, manette_mapping_new (MAPPING_EMPTY, NULL));
+
+  return mappings;
+}
+
+/* How the bindings were stored before they were packed: for each input type,
+ * an array indexed by the source input of NULL-terminated arrays of pointers
+ * to copies of the bindings.
+ */
+#define N_INPUT_TYPES (MANETTE_MAPPING_INPUT_TYPE_HAT + 1)
+
+typedef struct {
+  GArray *type_arrays[N_INPUT_TYPES];
+} UnpackedBindings;
+
+static void
+binding_try_free (ManetteMappingBinding **binding)
+{
+  if (G_LIKELY (binding))
+    g_clear_pointer (binding, manette_mapping_binding_free);
+}
+
+static void
+array_try_free (GArray **array)
+{
+  if (G_LIKELY (array))
+    g_clear_pointer (array, g_array_unref);
+}
+
+static void
+unpacked_bindings_free (UnpackedBindings *self)
+{
+  guint type;
+
+  for (type = 0; type < N_INPUT_TYPES; type++)
+    g_array_unref (self->type_arrays[type]);
+
+  g_free (self);
+}
+
+static void
+append_binding (GArray                      *type_array,
+                const ManetteMappingBinding *binding)
+{
+  GArray *binding_array;
+  ManetteMappingBinding *binding_copy;
+  guint16 index = binding->source.index;
+
+  if (type_array->len <= index)
+    g_array_set_size (type_array, index + 1);
+
+  if (g_array_index (type_array, GArray *, index) == NULL) {
+    binding_array = g_array_new (TRUE, TRUE, sizeof (ManetteMappingBinding *));
+    g_array_set_clear_func (binding_array, (GDestroyNotify) binding_try_free);
+    g_array_index (type_array, GArray *, index) = binding_array;
+  }
+  else
+    binding_array = g_array_index (type_array, GArray *, index);
+
+  binding_copy = manette_mapping_binding_copy ((ManetteMappingBinding *) binding);
+  g_array_append_val (binding_array, binding_copy);
+}
+
+static UnpackedBindings *
+unpack_bindings (ManetteMapping *mapping)
+{
+  UnpackedBindings *self = g_new0 (UnpackedBindings, 1);
+  guint type;
+
+  for (type = 0; type < N_INPUT_TYPES; type++) {
+    const ManetteMappingBinding *bindings;
+    gsize n_bindings, i;
+    guint16 index;
+
+    self->type_arrays[type] = g_array_new (FALSE, TRUE, sizeof (GArray *));
+    g_array_set_clear_func (self->type_arrays[type], (GDestroyNotify) array_try_free);
+
+    for (index = 0;
+         (bindings = manette_mapping_get_bindings (mapping, type, index, &n_bindings)) != NULL;
+         index++)
+      for (i = 0; i < n_bindings; i++)
+        append_binding (self->type_arrays[type], &bindings[i]);
+  }
+
+  return self;
+}
+
+static void
+test_bindings_perf (void)
+{
+  g_autoptr (GPtrArray) mappings = NULL;
+  g_autoptr (GPtrArray) empty_mappings = NULL;
+  g_autoptr (GPtrArray) unpacked = NULL;
+  double packed_elapsed, unpacked_elapsed;
+  gsize packed_heap, unpacked_heap, heap;
+  guint sum = 0, unpacked_sum = 0;
+  guint round, i, type, index, j;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("Performance tests not enabled, use -m perf");
+
+    return;
+  }
+
+  /* Both layouts are measured without the mapping instances, only the
+   * storage of the bindings is compared.
+   */
+  heap = manette_test_heap_get_size ();
+  mappings = parse_default_mappings ();
+  packed_heap = manette_test_heap_get_size () - heap;
+
+  heap = manette_test_heap_get_size ();
+  empty_mappings = parse_empty_mappings (mappings->len);
+  packed_heap -= manette_test_heap_get_size () - heap;
+
+  heap = manette_test_heap_get_size ();
+  unpacked = g_ptr_array_new_with_free_func ((GDestroyNotify) unpacked_bindings_free);
+  for (i = 0; i < mappings->len; i++)
+    g_ptr_array_add (unpacked, unpack_bindings (g_ptr_array_index (mappings, i)));
+  unpacked_heap = manette_test_heap_get_size () - heap;
+
+  g_test_timer_start ();
+  for (round = 0; round < N_ITERATION_ROUNDS; round++) {
+    for (i = 0; i < mappings->len; i++) {
+      ManetteMapping *mapping = g_ptr_array_index (mappings, i);
+
+      for (type = MANETTE_MAPPING_INPUT_TYPE_AXIS; type <= MANETTE_MAPPING_INPUT_TYPE_HAT; type++) {
+        const ManetteMappingBinding *bindings;
+        gsize n_bindings;
+
+        for (index = 0;
+             (bindings = manette_mapping_get_bindings (mapping, type, index, &n_bindings)) != NULL;
+             index++)
+          for (j = 0; j < n_bindings; j++)
+            sum += bindings[j].destination.code;
+      }
+    }
+  }
+  packed_elapsed = g_test_timer_elapsed ();
+
+  g_test_timer_start ();
+  for (round = 0; round < N_ITERATION_ROUNDS; round++) {
+    for (i = 0; i < unpacked->len; i++) {
+      UnpackedBindings *bindings = g_ptr_array_index (unpacked, i);
+
+      for (type = 0; type < N_INPUT_TYPES; type++) {
+        GArray *type_array = bindings->type_arrays[type];
+
+        for (index = 0; index < type_array->len; index++) {
+          GArray *bindings_array = g_array_index (type_array, GArray *, index);
+          ManetteMappingBinding **binding;
+
+          if (bindings_array == NULL)
+            continue;
+
+          for (binding = (ManetteMappingBinding **) bindings_array->data; *binding != NULL; binding++)
+            unpacked_sum += (*binding)->destination.code;
+        }
+      }
+    }
+  }
+  unpacked_elapsed = g_test_timer_elapsed ();
+
+  g_assert_cmpuint (sum, ==, unpacked_sum);
+
+  if (manette_test_heap_can_get_size ()) {
+    g_test_minimized_result ((double) packed_heap / mappings->len,
+                             "Heap used by the packed bindings of a mapping: %.0f bytes",
+                             (double) packed_heap / mappings->len);
+    g_test_minimized_result ((double) unpacked_heap / mappings->len,
+                             "Heap used by the unpacked bindings of a mapping: %.0f bytes",
+                             (double) unpacked_heap / mappings->len);
+  }
+  g_test_minimized_result (packed_elapsed / N_ITERATION_ROUNDS * G_USEC_PER_SEC,
+                           "Iterating over the packed bindings: %.2f µs",
+                           packed_elapsed / N_ITERATION_ROUNDS * G_USEC_PER_SEC);
+  g_test_minimized_result (unpacked_elapsed / N_ITERATION_ROUNDS * G_USEC_PER_SEC,
+                           "Iterating over the unpacked bindings: %.2f µs",
+                           unpacked_elapsed / N_ITERATION_ROUNDS * G_USEC_PER_SEC);
+}
+
 int
 main (int   argc,
       char *argv[])
@@ -393,6 +738,10 @@ main (int   argc,
   g_test_add_func ("/ManetteMapping/test_hat_x_bindings", test_hat_x_bindings);
   g_test_add_func ("/ManetteMapping/test_hat_y_bindings", test_hat_y_bindings);
   g_test_add_func ("/ManetteMapping/test_has_destination_input", test_has_destination_input);
+  g_test_add_func ("/ManetteMapping/test_dispatch", test_dispatch);
+  g_test_add_func ("/ManetteMapping/test_shared", test_shared);
+  g_test_add_func ("/ManetteMapping/test_parse_perf", test_parse_perf);
+  g_test_add_func ("/ManetteMapping/test_bindings_perf", test_bindings_perf);
 
   return g_test_run();
 }
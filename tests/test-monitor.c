@@ -0,0 +1,270 @@
+/* test-monitor.c
+ *
+ * Copyright (C) 2026 The libmanette authors
+ *
+ * This file is free software; you can redistribute it and/or modify it
+ * under the terms of the GNU Lesser General Public License as
+ * published by the Free Software Foundation; either version 2.1 of the
+ * License, or (at your option) any later version.
+ *
+ * This file is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "../src/manette-monitor-private.h"
+#include "manette-fake-backend.h"
+
+/* Like the blocking read of the Steam Deck's initialization */
+#define INIT_MS 16
+#define N_DEVICES 8
+#define N_PERF_DEVICES 32
+
+static ManetteBackend *
+new_fake_backend (void)
+{
+  ManetteFakeBackend *backend = g_object_new (MANETTE_TYPE_FAKE_BACKEND, NULL);
+
+  backend->init_delay_ms = INIT_MS;
+
+  return MANETTE_BACKEND (backend);
+}
+
+static void
+device_connected_cb (ManetteMonitor *monitor,
+                     ManetteDevice  *device,
+                     guint          *n_devices)
+{
+  /* Ignore the actual devices of the machine */
+  if (g_strcmp0 (manette_device_get_name (device), "Fake") != 0)
+    return;
+
+  /* The devices are initialized on other threads, but reported on ours */
+  g_assert_true (g_main_context_is_owner (g_main_context_default ()));
+
+  (*n_devices)++;
+}
+
+static void
+add_fake_devices (ManetteMonitor *monitor,
+                  guint           n_devices)
+{
+  guint i;
+
+  for (i = 0; i < n_devices; i++) {
+    g_autofree char *filename = g_strdup_printf ("/fake/device%u", i);
+
+    manette_monitor_add_backend (monitor, filename, new_fake_backend ());
+  }
+}
+
+static guint
+count_fake_devices (ManetteMonitor *monitor)
+{
+  g_autofree ManetteDevice **devices = NULL;
+  gsize n_devices, i;
+  guint n_fake_devices = 0;
+
+  devices = manette_monitor_list_devices (monitor, &n_devices);
+  for (i = 0; i < n_devices; i++)
+    if (g_strcmp0 (manette_device_get_name (devices[i]), "Fake") == 0)
+      n_fake_devices++;
+
+  return n_fake_devices;
+}
+
+static void
+test_coldplug (void)
+{
+  g_autoptr (ManetteMonitor) monitor = NULL;
+  guint n_devices = 0;
+
+  monitor = manette_monitor_new ();
+  g_signal_connect (monitor, "device-connected", G_CALLBACK (device_connected_cb), &n_devices);
+
+  add_fake_devices (monitor, N_DEVICES);
+  /* Adding a device again while it's being initialized has no effect */
+  add_fake_devices (monitor, N_DEVICES);
+
+  g_assert_cmpuint (n_devices, ==, 0);
+  g_assert_cmpuint (count_fake_devices (monitor), ==, 0);
+
+  while (n_devices < N_DEVICES)
+    g_main_context_iteration (NULL, TRUE);
+
+  g_assert_cmpuint (count_fake_devices (monitor), ==, N_DEVICES);
+}
+
+static void
+test_unplug (void)
+{
+  g_autoptr (ManetteMonitor) monitor = NULL;
+  guint n_devices = 0;
+  guint i;
+
+  monitor = manette_monitor_new ();
+  g_signal_connect (monitor, "device-connected", G_CALLBACK (device_connected_cb), &n_devices);
+
+  /* Unplugging the devices while they are initialized cancels it */
+  add_fake_devices (monitor, N_DEVICES);
+  for (i = 0; i < N_DEVICES; i++) {
+    g_autofree char *filename = g_strdup_printf ("/fake/device%u", i);
+
+    manette_monitor_remove_device (monitor, filename);
+  }
+
+  /* Plugging one back in only reports it once */
+  add_fake_devices (monitor, 1);
+
+  while (n_devices < 1)
+    g_main_context_iteration (NULL, TRUE);
+  while (g_main_context_iteration (NULL, FALSE));
+
+  g_assert_cmpuint (n_devices, ==, 1);
+  g_assert_cmpuint (count_fake_devices (monitor), ==, 1);
+}
+
+#define EVENT_QUEUE_SIZE 4
+
+static ManetteEvent
+poll_event (ManetteMonitor *monitor)
+{
+  ManetteEvent event;
+
+  while (manette_monitor_poll_events (monitor, &event, 1) == 0)
+    g_usleep (1000);
+
+  return event;
+}
+
+static void
+emit_frames (ManetteBackend *backend,
+             guint64         first_time,
+             guint           n_frames)
+{
+  ManetteBackendEventSink *sink = manette_backend_get_event_sink (backend);
+  guint i;
+
+  for (i = 0; i < n_frames; i++)
+    manette_backend_event_sink_emit_frame (sink, first_time + i);
+}
+
+static void
+test_poll_events (void)
+{
+  g_autoptr (ManetteMonitor) monitor = NULL;
+  g_autoptr (ManetteBackend) backend = NULL;
+  ManetteBackendEventSink *sink;
+  ManetteEvent events[EVENT_QUEUE_SIZE];
+  ManetteEvent event;
+  guint device_id;
+
+  monitor = g_object_new (MANETTE_TYPE_MONITOR,
+                          "event-queue-size", EVENT_QUEUE_SIZE,
+                          NULL);
+  backend = new_fake_backend ();
+  sink = manette_backend_get_event_sink (backend);
+
+  /* Polling dispatches the initialization, no need to iterate the context */
+  manette_monitor_add_backend (monitor, "/fake/device0", g_object_ref (backend));
+  event = poll_event (monitor);
+  g_assert_cmpint (event.type, ==, MANETTE_EVENT_DEVICE_CONNECTED);
+  device_id = event.device_id;
+  g_assert_nonnull (manette_monitor_get_device (monitor, device_id));
+  g_assert_cmpstr (manette_device_get_name (manette_monitor_get_device (monitor, device_id)), ==, "Fake");
+
+  manette_backend_event_sink_emit_button (sink, 10, MANETTE_BUTTON_SOUTH, TRUE);
+  manette_backend_event_sink_emit_unmapped_hat (sink, 10, 1, -1);
+  manette_backend_event_sink_emit_frame (sink, 10);
+
+  g_assert_cmpuint (manette_monitor_poll_events (monitor, events, EVENT_QUEUE_SIZE), ==, 3);
+  g_assert_cmpint (events[0].type, ==, MANETTE_EVENT_BUTTON_PRESSED);
+  g_assert_cmpuint (events[0].device_id, ==, device_id);
+  g_assert_cmpuint (events[0].time, ==, 10);
+  g_assert_cmpuint (events[0].index, ==, MANETTE_BUTTON_SOUTH);
+  g_assert_cmpint (events[1].type, ==, MANETTE_EVENT_UNMAPPED_HAT_AXIS_CHANGED);
+  g_assert_cmpuint (events[1].index, ==, 1);
+  g_assert_cmpfloat (events[1].value, ==, -1.0);
+  g_assert_cmpint (events[2].type, ==, MANETTE_EVENT_FRAME);
+  g_assert_cmpuint (manette_monitor_get_n_dropped_events (monitor), ==, 0);
+
+  /* By default the events arriving while the queue is full are dropped */
+  emit_frames (backend, 20, EVENT_QUEUE_SIZE + 2);
+  g_assert_cmpuint (manette_monitor_poll_events (monitor, events, EVENT_QUEUE_SIZE), ==, EVENT_QUEUE_SIZE);
+  g_assert_cmpuint (events[0].time, ==, 20);
+  g_assert_cmpuint (events[EVENT_QUEUE_SIZE - 1].time, ==, 20 + EVENT_QUEUE_SIZE - 1);
+  g_assert_cmpuint (manette_monitor_get_n_dropped_events (monitor), ==, 2);
+
+  g_object_set (monitor, "event-queue-overflow", MANETTE_EVENT_OVERFLOW_DROP_OLDEST, NULL);
+  emit_frames (backend, 30, EVENT_QUEUE_SIZE + 2);
+  g_assert_cmpuint (manette_monitor_poll_events (monitor, events, EVENT_QUEUE_SIZE), ==, EVENT_QUEUE_SIZE);
+  g_assert_cmpuint (events[0].time, ==, 32);
+  g_assert_cmpuint (events[EVENT_QUEUE_SIZE - 1].time, ==, 30 + EVENT_QUEUE_SIZE + 1);
+  g_assert_cmpuint (manette_monitor_get_n_dropped_events (monitor), ==, 4);
+
+  manette_monitor_remove_device (monitor, "/fake/device0");
+  event = poll_event (monitor);
+  g_assert_cmpint (event.type, ==, MANETTE_EVENT_DEVICE_DISCONNECTED);
+  g_assert_cmpuint (event.device_id, ==, device_id);
+  g_assert_null (manette_monitor_get_device (monitor, device_id));
+}
+
+static void
+test_coldplug_perf (void)
+{
+  g_autoptr (ManetteMonitor) monitor = NULL;
+  double serial_elapsed, parallel_elapsed;
+  guint n_devices = 0;
+  guint i;
+
+  if (!g_test_perf ()) {
+    g_test_skip ("Performance tests not enabled, use -m perf");
+
+    return;
+  }
+
+  /* How the devices were initialized before: one after the other, on the
+   * thread creating the monitor.
+   */
+  g_test_timer_start ();
+  for (i = 0; i < N_PERF_DEVICES; i++) {
+    g_autoptr (ManetteBackend) backend = new_fake_backend ();
+
+    g_assert_true (manette_backend_initialize (backend));
+  }
+  serial_elapsed = g_test_timer_elapsed ();
+
+  g_test_timer_start ();
+  monitor = manette_monitor_new ();
+  g_signal_connect (monitor, "device-connected", G_CALLBACK (device_connected_cb), &n_devices);
+  add_fake_devices (monitor, N_PERF_DEVICES);
+  while (n_devices < N_PERF_DEVICES)
+    g_main_context_iteration (NULL, TRUE);
+  parallel_elapsed = g_test_timer_elapsed ();
+
+  g_test_minimized_result (serial_elapsed * 1000,
+                           "Initializing %u devices serially: %.1f ms",
+                           N_PERF_DEVICES, serial_elapsed * 1000);
+  g_test_minimized_result (parallel_elapsed * 1000,
+                           "Initializing %u devices asynchronously: %.1f ms",
+                           N_PERF_DEVICES, parallel_elapsed * 1000);
+}
+
+int
+main (int   argc,
+      char *argv[])
+{
+  /* Don't touch the actual user mappings */
+  g_test_init (&argc, &argv, G_TEST_OPTION_ISOLATE_DIRS, NULL);
+
+  g_test_add_func ("/ManetteMonitor/test_coldplug", test_coldplug);
+  g_test_add_func ("/ManetteMonitor/test_unplug", test_unplug);
+  g_test_add_func ("/ManetteMonitor/test_poll_events", test_poll_events);
+  g_test_add_func ("/ManetteMonitor/test_coldplug_perf", test_coldplug_perf);
+
+  return g_test_run();
+}
@@ -0,0 +1,145 @@
+#!/usr/bin/env python3
+
+# Compiles the SDL game controller database into the binary format read by
+# ManetteMappingManager, so it can be looked up in place without being parsed.
+#
+# Only the mappings libmanette supports are kept. Their bindings are
+# validated like src/manette-mapping.c parses them, so the shipped database
+# doesn't trip its runtime checks, and the bindings left unbound, like
+# "leftx:", are dropped. The format is little-endian:
+#
+#   header:  char magic[8], guint32 n_entries, guint32 reserved
+#   entries: char guid[32], guint32 mapping_offset, guint32 mapping_length
+#   strings: the NUL-terminated mapping strings
+#
+# The entries are sorted by GUID, and the offsets are from the start of the
+# file. Keep in sync with src/manette-mapping-manager.c.
+
+import re
+import struct
+import sys
+
+MAGIC = b'MANETTE1'
+HEADER_FORMAT = '<8sII'
+ENTRY_FORMAT = '<32sII'
+
+GUID_RE = re.compile(r'^[0-9a-f]{32}$')
+
+# key:[+-]?[abh]N[.N]~?, only axes have a range and can be inverted
+DESTINATION_RE = re.compile(r'^[+-]?(?P<name>[a-z0-9]+)$')
+SOURCE_RE = re.compile(r'^(?:[+-]?a(?P<axis>[0-9]+)~?|b(?P<button>[0-9]+)|h(?P<hat>[0-9]+)\.(?P<position>[0-9]+))$')
+
+MAX_INDEX = 0xffff
+
+DESTINATIONS = {
+    'leftx', 'lefty', 'rightx', 'righty', 'lefttrigger', 'righttrigger',
+    'dpup', 'dpdown', 'dpleft', 'dpright', 'y', 'a', 'x', 'b', 'back',
+    'start', 'guide', 'leftshoulder', 'rightshoulder', 'leftstick',
+    'rightstick', 'paddle1', 'paddle2', 'paddle3', 'paddle4', 'misc1',
+    'misc2', 'misc3', 'misc4', 'misc5', 'misc6', 'touchpad',
+}
+
+
+def is_supported(mapping):
+    platform = mapping.find('platform')
+    if platform >= 0 and not mapping.startswith('platform:Linux', platform):
+        return False
+
+    hint = mapping.find('hint')
+    if hint >= 0 and not mapping.startswith('hint:SDL_GAMECONTROLLER_USE_BUTTON_LABELS:=1', hint):
+        return False
+
+    return True
+
+
+def is_valid_source(source):
+    match = SOURCE_RE.match(source)
+    if not match:
+        return False
+
+    if any(int(index) > MAX_INDEX for index in match.groups() if index is not None):
+        return False
+
+    # The hat position is a power of two, one per direction
+    if match['position'] is not None and int(match['position']).bit_length() > 4:
+        return False
+
+    return True
+
+
+def drop_unbound_bindings(mapping):
+    return ','.join(field for field in mapping.split(',') if not field.endswith(':'))
+
+
+def find_invalid_binding(mapping):
+    for field in mapping.split(',')[2:]:
+        # Like at runtime, fields that aren't key:value pairs are ignored
+        if field.count(':') != 1:
+            continue
+
+        key, value = field.split(':')
+        if key == 'platform':
+            continue
+
+        match = DESTINATION_RE.match(key)
+        if not match or match['name'] not in DESTINATIONS or not is_valid_source(value):
+            return field
+
+    return None
+
+
+def parse(path):
+    mappings = {}
+
+    with open(path, encoding='utf-8') as f:
+        for number, line in enumerate(f, 1):
+            mapping = line.strip()
+
+            if not mapping or mapping.startswith('#'):
+                continue
+
+            if not is_supported(mapping):
+                continue
+
+            fields = mapping.split(',', 2)
+            if len(fields) < 3 or not GUID_RE.match(fields[0]) or not fields[1]:
+                sys.exit(f'{path}:{number}: invalid mapping: {mapping}')
+
+            mapping = drop_unbound_bindings(mapping)
+            binding = find_invalid_binding(mapping)
+            if binding is not None:
+                sys.exit(f'{path}:{number}: invalid binding {binding}: {mapping}')
+
+            # Like when parsing the text database, the last mapping wins
+            mappings[fields[0]] = mapping
+
+    return mappings
+
+
+def compile_db(mappings):
+    guids = sorted(mappings)
+    strings_offset = struct.calcsize(HEADER_FORMAT) + struct.calcsize(ENTRY_FORMAT) * len(guids)
+
+    header = struct.pack(HEADER_FORMAT, MAGIC, len(guids), 0)
+    entries = b''
+    strings = b''
+
+    for guid in guids:
+        mapping = mappings[guid].encode('utf-8')
+        entries += struct.pack(ENTRY_FORMAT, guid.encode('ascii'),
+                               strings_offset + len(strings), len(mapping))
+        strings += mapping + b'\0'
+
+    return header + entries + strings
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(f'Usage: {sys.argv[0]} INPUT OUTPUT')
+
+    with open(sys.argv[2], 'wb') as f:
+        f.write(compile_db(parse(sys.argv[1])))
+
+
+if __name__ == '__main__':
+    main()